@@ -7,7 +7,29 @@
 #include <fstream>
 #include <sstream>
 #include <regex>
-#include <ctime>
+#include <cstdint>
+#include <climits>
+#include <new>
+#include <utility>
+#include <chrono>
+#include <cmath>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <map>
+#include <cstdlib>
+#include <algorithm>
+#include <sys/stat.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <io.h>
+#endif
 
 using namespace std;
 
@@ -19,11 +41,15 @@ bool isNumber(const string &s) {
     return true;
 }
 
-const int MAX_MOVIES = 10;
-const int MAX_SCREENINGS = 50;
-const int MAX_BOOKINGS = 60;
-const int MAX_USERS = 20;
-const int MAX_SEATS = 30;
+const int MAX_TICKETS_PER_BOOKING = 30;
+const int MAX_HALL_SEATS = 1024;
+const int MAX_SEATS_PER_ROW = 64;   // a row always fits in one 64-bit mask
+const int DEFAULT_HALL_ROWS = 10;
+const int DEFAULT_SEATS_PER_ROW = 15;
+const uint32_t NO_SLOT = 0xFFFFFFFFu;   // end marker for intrusive slot lists
+
+// Every booking sits on two intrusive lists: its screening's and its user's.
+enum BookingList { BY_SCREENING = 0, BY_USER = 1 };
 
 bool running = true;
 
@@ -35,52 +61,202 @@ class Booking;
 class Screening;
 class Movie;
 
-string buildScreeningDateTime(const string& date, int hour, int minute, int durationMinutes) {
-    int year, month, day;
-    sscanf(date.c_str(), "%d-%d-%d", &year, &month, &day);
+// Calendar arithmetic for screening times: seconds since 1970-01-01 00:00 of the
+// cinema's wall clock. No time zone or DST is involved, so everything is integer
+// math (no libc time calls, no shared state) and text goes into caller buffers.
+const long long SECONDS_PER_DAY = 86400;
+const size_t SCREENING_TIME_LEN = 24;  // "YYYY-MM-DD HH:MM - HH:MM"
+
+constexpr bool isLeapYear(int y) {
+    return y % 4 == 0 && (y % 100 != 0 || y % 400 == 0);
+}
+
+constexpr int daysInMonth(int y, int m) {
+    return m == 2 ? 28 + isLeapYear(y) : 30 + ((m + (m > 7)) & 1);
+}
+
+constexpr long long daysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = (int)(y - era * 400);
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+constexpr void civilFromDays(long long z, int& y, int& m, int& d) {
+    z += 719468;
+    long long era = (z >= 0 ? z : z - 146096) / 146097;
+    int doe = (int)(z - era * 146097);
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = (int)(yoe + era * 400) + (m <= 2);
+}
+
+constexpr long long makeTime(int y, int mo, int d, int h, int mi) {
+    return daysFromCivil(y, mo, d) * SECONDS_PER_DAY + h * 3600 + mi * 60;
+}
+
+constexpr long long dayOf(long long t) {
+    return t >= 0 ? t / SECONDS_PER_DAY : (t - SECONDS_PER_DAY + 1) / SECONDS_PER_DAY;
+}
+
+struct CivilTime {
+    int year, month, day, hour, minute;
+};
 
-    struct tm startTime = {};
-    startTime.tm_year = year - 1900;
-    startTime.tm_mon = month - 1;
-    startTime.tm_mday = day;
-    startTime.tm_hour = hour;
-    startTime.tm_min = minute;
+constexpr CivilTime toCivil(long long t) {
+    CivilTime c{};
+    long long days = dayOf(t);
+    civilFromDays(days, c.year, c.month, c.day);
+    int secs = (int)(t - days * SECONDS_PER_DAY);
+    c.hour = secs / 3600;
+    c.minute = secs / 60 % 60;
+    return c;
+}
+
+static_assert(daysFromCivil(1970, 1, 1) == 0, "epoch");
+static_assert(daysFromCivil(2000, 3, 1) == 11017, "leap century");
+static_assert(daysInMonth(2024, 2) == 29 && daysInMonth(1900, 2) == 28 && daysInMonth(2026, 8) == 31 &&
+              daysInMonth(2026, 11) == 30, "month lengths");
+static_assert(toCivil(makeTime(2024, 2, 28, 23, 30) + 3600).day == 29, "rolls into leap day");
+static_assert(toCivil(makeTime(2026, 12, 31, 22, 0) + 7200).year == 2027, "rolls into new year");
+static_assert(toCivil(-60).year == 1969 && toCivil(-60).minute == 59, "before the epoch");
+
+static bool readDigits(const char* s, int n, int& out) {
+    out = 0;
+    for (int i = 0; i < n; i++) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        out = out * 10 + (s[i] - '0');
+    }
+    return true;
+}
+
+// The 10 characters "YYYY-MM-DD" at s, rejecting days the month doesn't have.
+static bool readDate(const char* s, int& y, int& m, int& d) {
+    if (s[4] != '-' || s[7] != '-' || !readDigits(s, 4, y) || !readDigits(s + 5, 2, m) ||
+        !readDigits(s + 8, 2, d)) return false;
+    return m >= 1 && m <= 12 && d >= 1 && d <= daysInMonth(y, m);
+}
+
+// The 5 characters "HH:MM" at s.
+static bool readClock(const char* s, int& h, int& mi) {
+    return s[2] == ':' && readDigits(s, 2, h) && readDigits(s + 3, 2, mi) && h <= 23 && mi <= 59;
+}
+
+// Exactly "YYYY-MM-DD".
+bool parseDate(const char* s, int& y, int& m, int& d) {
+    return strnlen(s, 11) == 10 && readDate(s, y, m, d);
+}
+
+// "YYYY-MM-DD HH:MM - HH:MM" as written by buildScreeningDateTime. An end at or
+// before the start is on the next day.
+bool parseScreeningTimes(const char* dt, long long& start, long long& end) {
+    int y, mo, d, h, mi, eh, emi;
+    if (strlen(dt) != SCREENING_TIME_LEN || dt[10] != ' ' || strncmp(dt + 16, " - ", 3) != 0) return false;
+    if (!readDate(dt, y, mo, d) || !readClock(dt + 11, h, mi) || !readClock(dt + 19, eh, emi)) return false;
+    long long day = daysFromCivil(y, mo, d) * SECONDS_PER_DAY;
+    start = day + h * 3600 + mi * 60;
+    end = day + eh * 3600 + emi * 60;
+    if (end <= start) end += SECONDS_PER_DAY;
+    return true;
+}
 
-    time_t startEpoch = mktime(&startTime);
-    time_t endEpoch = startEpoch + durationMinutes * 60;
+static void writeDigits(char* p, int v, int n) {
+    for (int i = n - 1; i >= 0; i--) {
+        p[i] = (char)('0' + v % 10);
+        v /= 10;
+    }
+}
 
-    struct tm* endTime = localtime(&endEpoch);
+// "HH:MM" (buf of at least 6).
+void formatClock(long long t, char* buf) {
+    int secs = (int)(t - dayOf(t) * SECONDS_PER_DAY);
+    writeDigits(buf, secs / 3600, 2);
+    buf[2] = ':';
+    writeDigits(buf + 3, secs / 60 % 60, 2);
+    buf[5] = '\0';
+}
 
-    char startBuf[20], endBuf[20];
-    strftime(startBuf, sizeof(startBuf), "%Y-%m-%d %H:%M", &startTime);
-    strftime(endBuf, sizeof(endBuf), "%H:%M", endTime);
+// "YYYY-MM-DD HH:MM" (buf of at least 17).
+void formatDateTime(long long t, char* buf) {
+    CivilTime c = toCivil(t);
+    writeDigits(buf, c.year, 4);
+    buf[4] = '-';
+    writeDigits(buf + 5, c.month, 2);
+    buf[7] = '-';
+    writeDigits(buf + 8, c.day, 2);
+    buf[10] = ' ';
+    formatClock(t, buf + 11);
+}
 
-    return string(startBuf) + " - " + string(endBuf);
+// "YYYY-MM-DD HH:MM - HH:MM" (buf of at least SCREENING_TIME_LEN + 1).
+void formatScreeningTime(long long start, long long end, char* buf) {
+    formatDateTime(start, buf);
+    memcpy(buf + 16, " - ", 3);
+    formatClock(end, buf + 19);
 }
 
-string buildScreeningDateTime(const string& date, int durationMinutes) {
+// Writes the screening time for a show starting at date ("YYYY-MM-DD") hour:minute
+// into out (at least SCREENING_TIME_LEN + 1). False if the date or time is invalid.
+bool buildScreeningDateTime(const char* date, int hour, int minute, int durationMinutes, char* out) {
     int year, month, day;
-    sscanf(date.c_str(), "%d-%d-%d", &year, &month, &day);
+    if (!parseDate(date, year, month, day) || hour < 0 || hour > 23 || minute < 0 || minute > 59) return false;
+    long long start = makeTime(year, month, day, hour, minute);
+    formatScreeningTime(start, start + durationMinutes * 60LL, out);
+    return true;
+}
 
-    struct tm startTime = {};
-    startTime.tm_year = year - 1900;
-    startTime.tm_mon = month - 1;
-    startTime.tm_mday = day;
-    startTime.tm_hour = 12;  // Fixed 12:00 noon
-    startTime.tm_min = 0;
+bool buildScreeningDateTime(const char* date, int durationMinutes, char* out) {
+    return buildScreeningDateTime(date, 12, 0, durationMinutes, out);  // Fixed 12:00 noon
+}
 
-    time_t startEpoch = mktime(&startTime);
-    time_t endEpoch = startEpoch + durationMinutes * 60;
+// Listings are formatted into a reusable string and written out a page (or a
+// LISTING_BLOCK) at a time, instead of going through cout and setw per field.
+// Cells are left-aligned and padded to width but never cut, as setw did.
+const size_t LISTING_BLOCK = 1 << 16;
 
-    struct tm* endTime = localtime(&endEpoch);
+void appendCell(string& out, const char* text, size_t width) {
+    size_t len = strlen(text);
+    out.append(text, len);
+    if (len < width) out.append(width - len, ' ');
+}
 
-    char startBuf[6], endBuf[6];
-    strftime(startBuf, sizeof(startBuf), "%H:%M", &startTime);
-    strftime(endBuf, sizeof(endBuf), "%H:%M", endTime);
+void appendCell(string& out, long long v, size_t width) {
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    char* p = end;
+    unsigned long long u = v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+    do {
+        *--p = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (v < 0) *--p = '-';
+    out.append(p, end - p);
+    if ((size_t)(end - p) < width) out.append(width - (end - p), ' ');
+}
 
-    return date + " " + string(startBuf) + " - " + string(endBuf);
+// Cents as "D.CC".
+void appendMoney(string& out, long long cents, size_t width) {
+    size_t start = out.size();
+    if (cents < 0) {
+        out += '-';
+        cents = -cents;
+    }
+    appendCell(out, cents / 100, 0);
+    out += '.';
+    out += (char)('0' + cents / 10 % 10);
+    out += (char)('0' + cents % 10);
+    if (out.size() - start < width) out.append(width - (out.size() - start), ' ');
 }
 
+void writeListing(string& out) {
+    fwrite(out.data(), 1, out.size(), stdout);
+    out.clear();
+}
 
 string toUpperStr(const string &s) {
     string result = s;
@@ -106,6 +282,289 @@ public:
 };
 
 
+// Generation-checked reference into a SlotMap. A handle goes stale (get() returns
+// nullptr) once its slot is erased, even if the slot is later reused.
+template <typename T>
+struct Handle {
+    static const uint32_t NULL_INDEX = 0xFFFFFFFFu;
+    uint32_t index;
+    uint32_t generation;
+    Handle() : index(NULL_INDEX), generation(0) {}
+    Handle(uint32_t i, uint32_t g) : index(i), generation(g) {}
+    bool isNull() const { return index == NULL_INDEX; }
+    bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+// Growable record store. Slots live in fixed-size chunks that are never moved, so
+// pointers stay valid while the store grows; erased slots go on a free list.
+template <typename T>
+class SlotMap {
+private:
+    static const uint32_t CHUNK_SHIFT = 12;
+    static const uint32_t CHUNK_SIZE = 1u << CHUNK_SHIFT;
+    static const uint32_t MAX_CHUNKS = 8192;   // 33M records per store
+
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+        uint32_t generation;
+        uint32_t nextFree;
+        bool occupied;
+    };
+
+    Slot* chunks[MAX_CHUNKS];
+    uint32_t chunkCount;
+    uint32_t slotCount;
+    uint32_t liveCount;
+    uint32_t freeHead;
+    uint32_t freshGeneration;   // first generation for slots past the high-water mark
+    uint32_t erasesSinceTrim;
+    const char* limitMessage;
+
+    Slot& slotAt(uint32_t index) const {
+        return chunks[index >> CHUNK_SHIFT][index & (CHUNK_SIZE - 1)];
+    }
+    static T* valueOf(Slot& s) { return reinterpret_cast<T*>(s.storage); }
+
+public:
+    explicit SlotMap(const char* limitMsg)
+        : chunkCount(0), slotCount(0), liveCount(0), freeHead(Handle<T>::NULL_INDEX), freshGeneration(1),
+          erasesSinceTrim(0), limitMessage(limitMsg) {}
+    SlotMap(const SlotMap&) = delete;
+    SlotMap& operator=(const SlotMap&) = delete;
+    ~SlotMap() {
+        clear();
+        for (uint32_t c = 0; c < chunkCount; c++) delete[] chunks[c];
+    }
+
+    template <typename... Args>
+    Handle<T> insert(Args&&... args) {
+        uint32_t index;
+        if (freeHead != Handle<T>::NULL_INDEX) {
+            index = freeHead;
+            freeHead = slotAt(index).nextFree;
+        } else {
+            if (slotCount == chunkCount * CHUNK_SIZE) {
+                if (chunkCount == MAX_CHUNKS) throw InputException(limitMessage);
+                chunks[chunkCount++] = new Slot[CHUNK_SIZE];
+            }
+            index = slotCount++;
+            slotAt(index).generation = freshGeneration;
+        }
+        Slot& s = slotAt(index);
+        new (s.storage) T(std::forward<Args>(args)...);
+        s.occupied = true;
+        liveCount++;
+        return Handle<T>(index, s.generation);
+    }
+
+    T* get(Handle<T> h) const {
+        if (h.index >= slotCount) return nullptr;
+        Slot& s = slotAt(h.index);
+        if (!s.occupied || s.generation != h.generation) return nullptr;
+        return valueOf(s);
+    }
+
+    // Unchecked access for handles the caller knows are live (e.g. fresh from insert).
+    T& at(Handle<T> h) const { return *valueOf(slotAt(h.index)); }
+
+    bool erase(Handle<T> h) {
+        if (!get(h)) return false;
+        Slot& s = slotAt(h.index);
+        valueOf(s)->~T();
+        s.occupied = false;
+        s.generation++;
+        s.nextFree = freeHead;
+        freeHead = h.index;
+        liveCount--;
+        // Each trim is O(slots) and is paid for by the slots/2 erases before it.
+        if (++erasesSinceTrim > slotCount / 2 && slotCount > CHUNK_SIZE && liveCount < slotCount / 4) trim();
+        return true;
+    }
+
+    // Lazy compaction, run once three quarters of the slots are dead: drops the free
+    // tail, releases its chunks and rebuilds the free list lowest-slot-first so new
+    // records pack toward the front. Live records never move, so handles stay valid.
+    void trim() {
+        erasesSinceTrim = 0;
+        uint32_t newCount = slotCount;
+        while (newCount > 0 && !slotAt(newCount - 1).occupied) {
+            newCount--;
+            if (slotAt(newCount).generation >= freshGeneration) freshGeneration = slotAt(newCount).generation + 1;
+        }
+        slotCount = newCount;
+        uint32_t keepChunks = (slotCount + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+        while (chunkCount > keepChunks) delete[] chunks[--chunkCount];
+        freeHead = Handle<T>::NULL_INDEX;
+        for (uint32_t i = slotCount; i-- > 0;) {
+            if (!slotAt(i).occupied) {
+                slotAt(i).nextFree = freeHead;
+                freeHead = i;
+            }
+        }
+    }
+
+    void clear() {
+        for (uint32_t i = 0; i < slotCount; i++) {
+            Slot& s = slotAt(i);
+            if (s.occupied) {
+                valueOf(s)->~T();
+                s.occupied = false;
+            }
+            if (s.generation >= freshGeneration) freshGeneration = s.generation + 1;
+        }
+        slotCount = liveCount = erasesSinceTrim = 0;
+        freeHead = Handle<T>::NULL_INDEX;
+    }
+
+    // Visits live records in slot order; f may erase the record it is given.
+    template <typename F>
+    void forEach(F f) const {
+        for (uint32_t i = 0; i < slotCount; i++) {
+            Slot& s = slotAt(i);
+            if (s.occupied) f(Handle<T>(i, s.generation), *valueOf(s));
+        }
+    }
+
+    // Like forEach, stopping once f returns false.
+    template <typename F>
+    void forEachWhile(F f) const {
+        for (uint32_t i = 0; i < slotCount; i++) {
+            Slot& s = slotAt(i);
+            if (s.occupied && !f(Handle<T>(i, s.generation), *valueOf(s))) return;
+        }
+    }
+
+    // Handle for a slot index taken from a secondary index; null if the slot is free.
+    Handle<T> handleAt(uint32_t index) const {
+        if (index >= slotCount || !slotAt(index).occupied) return Handle<T>();
+        return Handle<T>(index, slotAt(index).generation);
+    }
+
+    uint32_t size() const { return liveCount; }
+};
+
+uint64_t mixKey(uint64_t k) {
+    k ^= k >> 33; k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33; k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+uint64_t hashString(const char* s) {
+    uint64_t h = 0xcbf29ce484222325ULL;   // FNV-1a
+    while (*s) { h ^= (unsigned char)*s++; h *= 0x100000001b3ULL; }
+    return h;
+}
+
+// Open-addressing (linear probing) index from a 64-bit key to a SlotMap slot.
+// Keys may repeat (e.g. colliding string hashes); find() takes a predicate that
+// confirms the candidate slot really is the record being looked up.
+class HashIndex {
+private:
+    struct Entry {
+        uint64_t key;
+        uint32_t slot;
+    };
+    static const uint32_t EMPTY = 0xFFFFFFFFu;
+    Entry* table;
+    uint32_t mask;
+    uint32_t count;
+
+    void rehash(uint32_t newCapacity) {
+        Entry* old = table;
+        uint32_t oldCapacity = table ? mask + 1 : 0;
+        table = new Entry[newCapacity];
+        mask = newCapacity - 1;
+        for (uint32_t i = 0; i < newCapacity; i++) table[i].slot = EMPTY;
+        for (uint32_t i = 0; i < oldCapacity; i++) {
+            if (old[i].slot != EMPTY) place(old[i].key, old[i].slot);
+        }
+        delete[] old;
+    }
+
+    void place(uint64_t key, uint32_t slot) {
+        uint32_t i = (uint32_t)mixKey(key) & mask;
+        while (table[i].slot != EMPTY) i = (i + 1) & mask;
+        table[i].key = key;
+        table[i].slot = slot;
+    }
+
+public:
+    HashIndex() : table(nullptr), mask(0), count(0) { rehash(16); }
+    HashIndex(const HashIndex&) = delete;
+    HashIndex& operator=(const HashIndex&) = delete;
+    ~HashIndex() { delete[] table; }
+
+    // Bulk load of (key, slot) pairs. They are radix-sorted by home bucket first, so
+    // the table fills in one sequential sweep instead of a cache miss per insert.
+    void insertAll(vector<pair<uint64_t, uint32_t>>& entries) {
+        reserve(count + (uint32_t)entries.size());
+        vector<pair<uint64_t, uint32_t>> sorted(entries.size());
+        int bits = 0;
+        while ((1u << bits) <= mask) bits++;
+        for (int shift = 0; shift < bits; shift += 12) {
+            uint32_t histogram[4097] = {0};
+            for (const pair<uint64_t, uint32_t>& e : entries) histogram[((((uint32_t)mixKey(e.first) & mask) >> shift) & 4095) + 1]++;
+            for (int d = 0; d < 4096; d++) histogram[d + 1] += histogram[d];
+            for (const pair<uint64_t, uint32_t>& e : entries) sorted[histogram[(((uint32_t)mixKey(e.first) & mask) >> shift) & 4095]++] = e;
+            entries.swap(sorted);
+        }
+        for (const pair<uint64_t, uint32_t>& e : entries) place(e.first, e.second);
+        count += (uint32_t)entries.size();
+    }
+
+    void clear() {
+        for (uint32_t i = 0; i <= mask; i++) table[i].slot = EMPTY;
+        count = 0;
+    }
+
+    void reserve(uint32_t n) {
+        uint32_t capacity = mask + 1;
+        while (capacity < n * 2) capacity *= 2;
+        if (capacity != mask + 1) rehash(capacity);
+    }
+
+    void insert(uint64_t key, uint32_t slot) {
+        if ((count + 1) * 2 > mask + 1) rehash((mask + 1) * 2);
+        place(key, slot);
+        count++;
+    }
+
+    template <typename Match>
+    uint32_t find(uint64_t key, Match match) const {
+        for (uint32_t i = (uint32_t)mixKey(key) & mask; table[i].slot != EMPTY; i = (i + 1) & mask) {
+            if (table[i].key == key && match(table[i].slot)) return table[i].slot;
+        }
+        return EMPTY;
+    }
+
+    uint32_t find(uint64_t key) const {
+        return find(key, [](uint32_t) { return true; });
+    }
+
+    // Backward-shift deletion keeps probe chains intact without tombstones.
+    bool erase(uint64_t key, uint32_t slot) {
+        uint32_t i = (uint32_t)mixKey(key) & mask;
+        while (table[i].slot != EMPTY && !(table[i].key == key && table[i].slot == slot)) i = (i + 1) & mask;
+        if (table[i].slot == EMPTY) return false;
+        uint32_t hole = i;
+        for (uint32_t j = (hole + 1) & mask; table[j].slot != EMPTY; j = (j + 1) & mask) {
+            uint32_t home = (uint32_t)mixKey(table[j].key) & mask;
+            if (((j - home) & mask) >= ((j - hole) & mask)) {
+                table[hole] = table[j];
+                hole = j;
+            }
+        }
+        table[hole].slot = EMPTY;
+        count--;
+        return true;
+    }
+
+    uint32_t size() const { return count; }
+};
+
+
 class IBookingModificationStrategy {
 public:
     virtual void modifyBooking(Booking* booking) = 0;
@@ -129,9 +588,13 @@ private:
     char genre[20];
     int duration; // minutes
     double cost;
+    // Running report totals, kept up to date by every booking change. Concurrent
+    // sales only add to them, so they are atomics rather than lock-protected.
+    atomic<long long> bookedSeats;
+    atomic<long long> revenueCents;
 public:
-    Movie() : id(0), duration(0), cost(0.0) { name[0] = genre[0] = '\0'; }
-    Movie(int id_, const char* n, const char* g, int d, double c) : id(id_), duration(d), cost(c) {
+    Movie() : id(0), duration(0), cost(0.0), bookedSeats(0), revenueCents(0) { name[0] = genre[0] = '\0'; }
+    Movie(int id_, const char* n, const char* g, int d, double c) : id(id_), duration(d), cost(c), bookedSeats(0), revenueCents(0) {
         strncpy(name, n, 49); name[49] = '\0';
         strncpy(genre, g, 19); genre[19] = '\0';
     }
@@ -140,78 +603,402 @@ public:
     const char* getGenre() const { return genre; }
     int getDuration() const { return duration; }
     double getCost() const { return cost; }
+    long long getBookedSeats() const { return bookedSeats.load(memory_order_relaxed); }
+    long long getRevenueCents() const { return revenueCents.load(memory_order_relaxed); }
+    long long getCostCents() const { return llround(cost * 100); }
+
+    // Snapshot load: totals saved with the movie instead of recounting its bookings.
+    void restoreTotals(long long seats, long long cents) {
+        bookedSeats.store(seats, memory_order_relaxed);
+        revenueCents.store(cents, memory_order_relaxed);
+    }
+
+    // seatDelta is negative for cancellations
+    void recordSale(int seatDelta) {
+        bookedSeats.fetch_add(seatDelta, memory_order_relaxed);
+        revenueCents.fetch_add(seatDelta * getCostCents(), memory_order_relaxed);
+    }
 
     void setName(const char* n) { strncpy(name, n, 49); name[49] = '\0'; }
     void setGenre(const char* g) { strncpy(genre, g, 19); genre[19] = '\0'; }
     void setDuration(int d) { duration = d; }
-    void setCost(double c) { cost = c; }
+    // Revenue is seats sold at the current price, as the reports always showed it.
+    void setCost(double c) {
+        cost = c;
+        revenueCents.store(getBookedSeats() * getCostCents(), memory_order_relaxed);
+    }
+};
 
-    void display() const {
-        cout << setw(4) << id << " | "
-             << setw(20) << left << name
-             << setw(10) << genre
- << setw(8) << duration
-<< fixed << setprecision(2)
-<< setw(8) << cost
-             << "\n";
+
+inline int popcount64(uint64_t w) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(w);
+#else
+    w = w - ((w >> 1) & 0x5555555555555555ULL);
+    w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+    w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((w * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Index of the lowest / highest set bit; w must be non-zero.
+inline int lowestBit64(uint64_t w) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(w);
+#else
+    int n = 0;
+    while (!(w & 1)) { w >>= 1; n++; }
+    return n;
+#endif
+}
+
+inline int highestBit64(uint64_t w) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(w);
+#else
+    int n = 0;
+    while (w >>= 1) n++;
+    return n;
+#endif
+}
+
+// Seats are numbered 1..rows*seatsPerRow, row by row from the front.
+struct HallLayout {
+    int rows;
+    int seatsPerRow;
+    HallLayout() : rows(DEFAULT_HALL_ROWS), seatsPerRow(DEFAULT_SEATS_PER_ROW) {}
+    HallLayout(int r, int s) : rows(r), seatsPerRow(s) {}
+    int capacity() const { return rows * seatsPerRow; }
+    bool isValid() const {
+        return rows > 0 && seatsPerRow > 0 && seatsPerRow <= MAX_SEATS_PER_ROW && capacity() <= MAX_HALL_SEATS;
     }
 };
 
+// Sold seats as a bitmap, one bit per seat. Multi-seat requests are turned into
+// per-word masks and each word is claimed with a compare-and-swap, so concurrent
+// sellers never sell the same seat and need no lock to do it.
+class SeatMap {
+public:
+    static const int WORDS = MAX_HALL_SEATS / 64;
+private:
+    atomic<uint64_t> words[WORDS];
+    int capacity;
+
+    // Builds per-word masks for 1-based seat numbers; fails on out-of-range or
+    // repeated seats.
+    bool buildMasks(const int seatNums[], int count, uint64_t masks[WORDS]) const {
+        for (int w = 0; w < WORDS; w++) masks[w] = 0;
+        for (int i = 0; i < count; i++) {
+            int seat = seatNums[i] - 1;
+            if (seat < 0 || seat >= capacity) return false;
+            uint64_t bit = 1ULL << (seat & 63);
+            if (masks[seat >> 6] & bit) return false;
+            masks[seat >> 6] |= bit;
+        }
+        return true;
+    }
+
+    // Words are claimed in ascending order; if a later word clashes, the words already
+    // claimed are handed back.
+    bool claimMasks(const uint64_t masks[WORDS]) {
+        for (int w = 0; w < WORDS; w++) {
+            if (!masks[w]) continue;
+            uint64_t cur = words[w].load(memory_order_relaxed);
+            bool claimed = false;
+            while (!(cur & masks[w])) {
+                if (words[w].compare_exchange_weak(cur, cur | masks[w], memory_order_acq_rel)) {
+                    claimed = true;
+                    break;
+                }
+            }
+            if (!claimed) {
+                for (int u = 0; u < w; u++) {
+                    if (masks[u]) words[u].fetch_and(~masks[u], memory_order_release);
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    explicit SeatMap(int capacity_ = 0) : capacity(capacity_) {
+        for (int w = 0; w < WORDS; w++) words[w].store(0, memory_order_relaxed);
+    }
+
+    int getCapacity() const { return capacity; }
+
+    bool isFree(int seatNum) const {
+        int seat = seatNum - 1;
+        if (seat < 0 || seat >= capacity) return false;
+        return !(words[seat >> 6].load(memory_order_acquire) & (1ULL << (seat & 63)));
+    }
+
+    // Check only: every seat is valid, listed once and currently free.
+    bool allFree(const int seatNums[], int count) const {
+        uint64_t masks[WORDS];
+        if (!buildMasks(seatNums, count, masks)) return false;
+        for (int w = 0; w < WORDS; w++) {
+            if (words[w].load(memory_order_acquire) & masks[w]) return false;
+        }
+        return true;
+    }
+
+    // All-or-nothing: either every seat was free and is now sold, or nothing changed.
+    bool book(const int seatNums[], int count) {
+        uint64_t masks[WORDS];
+        if (!buildMasks(seatNums, count, masks)) return false;
+        return claimMasks(masks);
+    }
+
+    // Trades a held set of seats for another in the same map. Only the seats not
+    // already held are claimed, and the old ones are released after that succeeds,
+    // so a failed swap leaves the original seats sold to their holder.
+    bool swap(const int oldSeats[], int oldCount, const int newSeats[], int newCount) {
+        uint64_t oldMasks[WORDS], newMasks[WORDS];
+        if (!buildMasks(oldSeats, oldCount, oldMasks) || !buildMasks(newSeats, newCount, newMasks)) return false;
+        uint64_t gained[WORDS];
+        for (int w = 0; w < WORDS; w++) gained[w] = newMasks[w] & ~oldMasks[w];
+        if (!claimMasks(gained)) return false;
+        for (int w = 0; w < WORDS; w++) {
+            uint64_t dropped = oldMasks[w] & ~newMasks[w];
+            if (dropped) words[w].fetch_and(~dropped, memory_order_release);
+        }
+        return true;
+    }
+
+    void release(const int seatNums[], int count) {
+        for (int i = 0; i < count; i++) {
+            int seat = seatNums[i] - 1;
+            if (seat >= 0 && seat < capacity) words[seat >> 6].fetch_and(~(1ULL << (seat & 63)), memory_order_release);
+        }
+    }
+
+    // Sold bits for seats [start, start + len) as a mask; len <= 64, may span two words.
+    uint64_t bitsAt(int start, int len) const {
+        int w = start >> 6, off = start & 63;
+        uint64_t bits = words[w].load(memory_order_acquire) >> off;
+        if (off && off + len > 64 && w + 1 < WORDS) bits |= words[w + 1].load(memory_order_acquire) << (64 - off);
+        return len == 64 ? bits : bits & ((1ULL << len) - 1);
+    }
+
+    // Raw bitmap for snapshots.
+    void copyWords(uint64_t out[WORDS]) const {
+        for (int w = 0; w < WORDS; w++) out[w] = words[w].load(memory_order_relaxed);
+    }
+
+    void loadWords(const uint64_t in[WORDS]) {
+        for (int w = 0; w < WORDS; w++) words[w].store(in[w], memory_order_relaxed);
+    }
+
+    int bookedCount() const {
+        int n = 0;
+        for (int w = 0; w < WORDS; w++) n += popcount64(words[w].load(memory_order_relaxed));
+        return n;
+    }
+
+    int freeCount() const { return capacity - bookedCount(); }
+
+    bool anyFree() const {
+        int full = capacity >> 6;
+        for (int w = 0; w < full; w++) {
+            if (~words[w].load(memory_order_relaxed)) return true;
+        }
+        int rest = capacity & 63;
+        return rest && (~words[full].load(memory_order_relaxed) & ((1ULL << rest) - 1));
+    }
+
+    // Moves to a different hall size; refused if a sold seat would fall outside it.
+    bool resize(int newCapacity) {
+        if (newCapacity <= 0 || newCapacity > MAX_HALL_SEATS) return false;
+        for (int seat = newCapacity; seat < capacity; seat++) {
+            if (words[seat >> 6].load(memory_order_relaxed) & (1ULL << (seat & 63))) return false;
+        }
+        capacity = newCapacity;
+        return true;
+    }
+};
 
 class Screening {
 private:
     int id;
-    Movie* movie;
+    Handle<Movie> movie;
     char datetime[25];
+    long long startTime;     // see parseScreeningTimes
+    long long endTime;
     char cinemaHall[10];
-    bool seats[MAX_SEATS];
-    int seatCapacity;
+    HallLayout layout;
+    SeatMap seats;
+    uint32_t firstBooking;   // head of this screening's booking list (booking slots)
 public:
-    Screening() : id(0), movie(nullptr), seatCapacity(MAX_SEATS) {
+    Screening() : id(0), startTime(0), endTime(0), seats(layout.capacity()), firstBooking(NO_SLOT) {
         datetime[0] = cinemaHall[0] = '\0';
-        for (int i = 0; i < seatCapacity; i++) seats[i] = false;
     }
-    Screening(int id_, Movie* m, const char* dt, const char* ch) : id(id_), movie(m), seatCapacity(MAX_SEATS) {
+    Screening(int id_, Handle<Movie> m, const char* dt, long long start, long long end, const char* ch, HallLayout hl)
+        : id(id_), movie(m), startTime(start), endTime(end), layout(hl), seats(hl.capacity()), firstBooking(NO_SLOT) {
         strncpy(datetime, dt, 24); datetime[24] = '\0';
         strncpy(cinemaHall, ch, 9); cinemaHall[9] = '\0';
-        for (int i=0; i < seatCapacity; i++) seats[i] = false;
     }
 
     int getId() const { return id; }
-    Movie* getMovie() const { return movie; }
+    Handle<Movie> getMovie() const { return movie; }
     const char* getDateTime() const { return datetime; }
+    long long getStartTime() const { return startTime; }
+    long long getEndTime() const { return endTime; }
     const char* getCinemaHall() const { return cinemaHall; }
-    int getSeatCapacity() const { return seatCapacity; }
+    int getSeatCapacity() const { return seats.getCapacity(); }
+    int getFreeSeatCount() const { return seats.freeCount(); }
+    bool hasFreeSeat() const { return seats.anyFree(); }
+    const HallLayout& getLayout() const { return layout; }
+    uint32_t getFirstBooking() const { return firstBooking; }
+    uint32_t& bookingListHead() { return firstBooking; }
+
+    // Changes what/when/where is shown while keeping sold seats and bookings.
+    void reschedule(Handle<Movie> m, const char* dt, long long start, long long end, const char* ch, HallLayout hl) {
+        if (!seats.resize(hl.capacity())) throw InputException("New hall is too small for seats already sold.");
+        layout = hl;
+        movie = m;
+        strncpy(datetime, dt, 24); datetime[24] = '\0';
+        startTime = start;
+        endTime = end;
+        strncpy(cinemaHall, ch, 9); cinemaHall[9] = '\0';
+    }
 
-    bool isSeatAvailable(int seatNum) {
-        if (seatNum < 1 || seatNum > seatCapacity) return false;
-        return !seats[seatNum - 1];
+    bool isSeatAvailable(int seatNum) const {
+        return seats.isFree(seatNum);
     }
 
     bool bookSeats(const int seatNums[], int count) {
-        for (int i=0; i<count; i++) {
-            int s = seatNums[i];
-            if (s < 1 || s > seatCapacity || seats[s-1]) return false;
-        }
-        for (int i=0; i<count; i++) {
-            seats[seatNums[i]-1] = true;
+        return seats.book(seatNums, count);
+    }
+
+    bool seatsAvailable(const int seatNums[], int count) const {
+        return seats.allFree(seatNums, count);
+    }
+
+    bool swapSeats(const int oldSeats[], int oldCount, const int newSeats[], int newCount) {
+        return seats.swap(oldSeats, oldCount, newSeats, newCount);
+    }
+
+    // Best block of `count` adjacent free seats in one row, written to outSeats.
+    // Blocks are scored by distance from the middle of the row and from the
+    // preferred row two thirds of the way back. Each row is one 64-bit mask: runs of
+    // `count` free seats are found by and-ing shifted copies, then the candidate
+    // nearest the row centre is picked with one ctz/clz, so a hall costs O(rows).
+    bool findBestBlock(int count, int outSeats[]) const {
+        int cols = layout.seatsPerRow;
+        if (count <= 0 || count > cols) return false;
+        uint64_t rowAll = cols == 64 ? ~0ULL : (1ULL << cols) - 1;
+        int idealRow = (layout.rows * 2) / 3;
+        if (idealRow >= layout.rows) idealRow = layout.rows - 1;
+        int idealStart = (cols - count) / 2;
+        int bestScore = -1, bestRow = 0, bestStart = 0;
+        for (int r = 0; r < layout.rows; r++) {
+            int rowScore = 2 * (r > idealRow ? r - idealRow : idealRow - r);
+            if (bestScore >= 0 && rowScore >= bestScore) continue;
+            uint64_t starts = ~seats.bitsAt(r * cols, cols) & rowAll;
+            for (int have = 1; have < count && starts;) {
+                int step = have < count - have ? have : count - have;
+                starts &= starts >> step;
+                have += step;
+            }
+            if (!starts) continue;
+            int candidates[2];
+            int n = 0;
+            uint64_t above = starts >> idealStart;
+            if (above) candidates[n++] = idealStart + lowestBit64(above);
+            uint64_t below = idealStart == 63 ? starts : starts & ((2ULL << idealStart) - 1);
+            if (below) candidates[n++] = highestBit64(below);
+            for (int i = 0; i < n; i++) {
+                int colScore = 2 * candidates[i] + count - cols;
+                if (colScore < 0) colScore = -colScore;
+                int score = rowScore + colScore;
+                if (bestScore < 0 || score < bestScore) {
+                    bestScore = score;
+                    bestRow = r;
+                    bestStart = candidates[i];
+                }
+            }
         }
+        if (bestScore < 0) return false;
+        for (int i = 0; i < count; i++) outSeats[i] = bestRow * cols + bestStart + i + 1;
         return true;
     }
 
     void cancelSeats(const int seatNums[], int count) {
-        for (int i=0; i<count; i++) {
-            int s = seatNums[i];
-            if (s >=1 && s <= seatCapacity) seats[s-1] = false;
-        }
+        seats.release(seatNums, count);
     }
 
-    void display() const {
+    const SeatMap& getSeatMap() const { return seats; }
+    SeatMap& getSeatMap() { return seats; }
+
+    void display(const Movie& m) const {
         cout << setw(4) << id << " | "
-             << setw(20) << left << movie->getName()
+             << setw(20) << left << m.getName()
              << setw(15) << datetime
              << setw(10) << cinemaHall
-             << "Seats: " << seatCapacity << "\n";
+             << "Seats: " << getFreeSeatCount() << "/" << getSeatCapacity() << "\n";
+    }
+};
+
+
+// Named cinema hall and its seating plan
+class Hall {
+private:
+    char name[10];
+    HallLayout layout;
+public:
+    Hall(const char* n, HallLayout hl) : layout(hl) {
+        strncpy(name, n, 9); name[9] = '\0';
+    }
+    const char* getName() const { return name; }
+    const HallLayout& getLayout() const { return layout; }
+    void setLayout(HallLayout hl) { layout = hl; }
+};
+
+// One hall's screenings ordered by start time. Screenings in a hall never overlap,
+// so the order by start is also the order by end and each lookup below needs one
+// O(log n) search plus the screenings it reports.
+class HallSchedule {
+private:
+    struct Showing {
+        long long end;
+        uint32_t slot;      // screening slot
+    };
+    char name[10];
+    map<long long, Showing> byStart;
+
+public:
+    explicit HallSchedule(const char* n) { strncpy(name, n, 9); name[9] = '\0'; }
+    const char* getName() const { return name; }
+
+    // A screening other than `except` that overlaps [start, end), or NO_SLOT. Only the
+    // last one starting before `end` can reach past `start`.
+    uint32_t conflict(long long start, long long end, uint32_t except) const {
+        map<long long, Showing>::const_iterator it = byStart.lower_bound(end);
+        for (int skipped = 0; it != byStart.begin() && skipped < 2; skipped++) {
+            --it;
+            if (it->second.slot != except) return it->second.end > start ? it->second.slot : NO_SLOT;
+        }
+        return NO_SLOT;
+    }
+
+    void insert(long long start, long long end, uint32_t slot) { byStart[start] = Showing{end, slot}; }
+    void erase(long long start) { byStart.erase(start); }
+
+    // f(slot) for every screening overlapping [from, to), in start order, until f
+    // returns false. Returns false if it stopped early.
+    template <typename F>
+    bool forEachBetween(long long from, long long to, F f) const {
+        map<long long, Showing>::const_iterator it = byStart.lower_bound(from);
+        if (it != byStart.begin()) {
+            map<long long, Showing>::const_iterator before = prev(it);
+            if (before->second.end > from) it = before;
+        }
+        for (; it != byStart.end() && it->first < to; ++it) {
+            if (!f(it->second.slot)) return false;
+        }
+        return true;
     }
 };
 
@@ -245,31 +1032,45 @@ public:
 class Booking {
 private:
     int id;
-    class RegularUser* user;
-    Screening* screening;
-    int seatNumbers[MAX_SEATS];
+    Handle<class RegularUser> user;
+    Handle<Screening> screening;
+    int seatNumbers[MAX_TICKETS_PER_BOOKING];
     int seatCount;
+    uint32_t prevLink[2];   // neighbours on the BY_SCREENING / BY_USER lists
+    uint32_t nextLink[2];
 
 public:
-    Booking() : id(0), user(nullptr), screening(nullptr), seatCount(0) {}
-    Booking(int id_, RegularUser* u, Screening* s, const int seats[], int count) : id(id_), user(u), screening(s), seatCount(count) {
+    Booking() : id(0), seatCount(0) { clearLinks(); }
+    Booking(int id_, Handle<RegularUser> u, Handle<Screening> s, const int seats[], int count)
+        : id(id_), user(u), screening(s), seatCount(count) {
+        clearLinks();
         for (int i=0; i < count; i++) seatNumbers[i] = seats[i];
     }
     int getId() const { return id; }
-    Screening* getScreening() const { return screening; }
-    RegularUser* getUser() const { return user; }
+    Handle<Screening> getScreening() const { return screening; }
+    Handle<RegularUser> getUser() const { return user; }
     int getSeatCount() const { return seatCount; }
     const int* getSeats() const { return seatNumbers; }
-    void display() const;
+    bool hasSeat(int seatNum) const {
+        for (int i = 0; i < seatCount; i++) {
+            if (seatNumbers[i] == seatNum) return true;
+        }
+        return false;
+    }
+    uint32_t getPrev(BookingList list) const { return prevLink[list]; }
+    uint32_t getNext(BookingList list) const { return nextLink[list]; }
+    void setLinks(BookingList list, uint32_t prev, uint32_t next) { prevLink[list] = prev; nextLink[list] = next; }
+    void clearLinks() { prevLink[0] = prevLink[1] = nextLink[0] = nextLink[1] = NO_SLOT; }
+    void display(const Screening& s, const Movie& m) const;
 
-    void changeBooking(Screening* newScreening, const int newSeats[], int newCount);
+    void changeBooking(Handle<Screening> newScreening, const int newSeats[], int newCount);
 };
 
 
-void Booking::display() const {
+void Booking::display(const Screening& s, const Movie& m) const {
     cout << "Booking ID: " << id << "\n"
-         << "Movie: " << screening->getMovie()->getName() << "\n"
-         << "Date & Time: " << screening->getDateTime() << "\n"
+         << "Movie: " << m.getName() << "\n"
+         << "Date & Time: " << s.getDateTime() << "\n"
          << "Seats: ";
     for (int i = 0; i < seatCount; i++) {
         cout << seatNumbers[i];
@@ -278,11 +1079,8 @@ void Booking::display() const {
     cout << "\n";
 }
 
-void Booking::changeBooking(Screening* newScreening, const int newSeats[], int newCount) {
-    if (!newScreening->bookSeats(newSeats, newCount)) {
-        throw InputException("Failed to book requested seats for modified booking.");
-    }
-    screening->cancelSeats(seatNumbers, seatCount);
+// Seat maps are updated by CinemaBookingSystem::changeBooking; this only rewrites the record.
+void Booking::changeBooking(Handle<Screening> newScreening, const int newSeats[], int newCount) {
     screening = newScreening;
     seatCount = newCount;
     for (int i = 0; i < newCount; i++) {
@@ -294,13 +1092,19 @@ void Booking::changeBooking(Screening* newScreening, const int newSeats[], int n
 class RegularUser : public User {
 private:
     class CinemaBookingSystem* system;
+    int id;
+    uint32_t firstBooking;   // head of this user's booking list (booking slots)
 
 public:
     RegularUser();
+    RegularUser(class CinemaBookingSystem* sys, int id_);
     RegularUser(const RegularUser& other);
     RegularUser& operator=(const RegularUser& other);
     ~RegularUser() {}
 
+    int getId() const { return id; }
+    uint32_t& bookingListHead() { return firstBooking; }
+
     void login() override;
     void signup() override;
     void displayDashboard() override;
@@ -308,74 +1112,1298 @@ public:
     void modifyBooking();
     void cancelBooking();
     void viewMyBookings();
-};
 
-// CinemaBookingSystem Singleton
-class CinemaBookingSystem {
 private:
-    Movie movies[MAX_MOVIES];
-    int movieCount;
-    Screening screenings[MAX_SCREENINGS];
-    int screeningCount;
-    Booking bookings[MAX_BOOKINGS];
-    int bookingCount;
-    RegularUser* users[MAX_USERS];
-    int userCount;
-    User* currentUser;
-    static CinemaBookingSystem* instance;
-    IBookingModificationStrategy* bookingModificationStrategy;
+    bool owns(const Booking* booking) const;
+};
 
-    char adminUsername[20];
-    char adminPassword[20];
+// Workload traces: every mutating CinemaBookingSystem call can be appended to a
+// compact binary file and re-run later by --replay.
+//
+// File: "CBTRACE" + version byte, then records of
+//   op (u8) | ok (u8) | microseconds since previous record (varint) | payload length (varint) | payload
+// Payload integers are LEB128 varints, strings are varint length + bytes, costs are
+// raw little-endian doubles and seat lists are a count followed by the seats.
+// Records refer to users, screenings and bookings by ID. Passwords are not recorded.
+enum TraceOp {
+    TRACE_HALL = 1, TRACE_MOVIE, TRACE_EDIT_MOVIE, TRACE_DELETE_MOVIE, TRACE_SCREENING,
+    TRACE_EDIT_SCREENING, TRACE_DELETE_SCREENING, TRACE_USER, TRACE_BOOK, TRACE_BEST,
+    TRACE_GROUP, TRACE_CHANGE, TRACE_CANCEL, TRACE_OP_COUNT
+};
 
-    // Change the CinemaBookingSystem constructor to:
-CinemaBookingSystem() : movieCount(0), screeningCount(0), bookingCount(0), userCount(0), currentUser(nullptr) {
-    bookingModificationStrategy = new class BookingModificationStrategy(this);
-    strncpy(adminUsername, "ADMIN", 19); adminUsername[19] = '\0';
-    strncpy(adminPassword, "ADMIN123", 19); adminPassword[19] = '\0';
-    
-    loadUsersFromFile();  // Add this line
+const char TRACE_MAGIC[8] = {'C', 'B', 'T', 'R', 'A', 'C', 'E', 1};
+
+void putVarint(string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out += (char)(v | 0x80);
+        v >>= 7;
+    }
+    out += (char)v;
 }
-    
-    // File load/save helpers
-    void loadUsersFromFile() {
-        ifstream inFile("users.txt");
-        if (inFile.is_open()) {
-            string username, password;
-            while (inFile >> username >> password) {
-                if (userCount >= MAX_USERS) break;
-                RegularUser* user = new RegularUser();
-                user->setUsername(username.c_str());
-                user->setPassword(password.c_str());
-                users[userCount++] = user;
-            }
-            inFile.close();
+
+void putString(string& out, const char* str) {
+    size_t len = strlen(str);
+    putVarint(out, len);
+    out.append(str, len);
+}
+
+void putDouble(string& out, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    for (int i = 0; i < 8; i++) out += (char)(bits >> (8 * i));
+}
+
+void putSeats(string& out, const int seats[], int count) {
+    putVarint(out, (uint64_t)count);
+    for (int i = 0; i < count; i++) putVarint(out, (uint64_t)seats[i]);
+}
+
+// Bounds-checked decoder for one record's payload; any overrun clears `ok`.
+struct TraceReader {
+    const unsigned char* p;
+    const unsigned char* end;
+    bool ok;
+
+    TraceReader(const unsigned char* begin, const unsigned char* end_) : p(begin), end(end_), ok(true) {}
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p == end) break;
+            unsigned char b = *p++;
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
         }
+        ok = false;
+        return 0;
     }
 
-    void saveUsersToFile() {
-        ofstream outFile("users.txt");
-        if (outFile.is_open()) {
-            for (int i = 0; i < userCount; i++) {
-                outFile << users[i]->getUsername() << " " << users[i]->getPassword() << endl;
-            }
-            outFile.close();
+    int integer() { return (int)varint(); }
+
+    // Copies into buf (truncated to size - 1).
+    void text(char* buf, size_t size) {
+        uint64_t len = varint();
+        if (!ok || len > (uint64_t)(end - p)) {
+            ok = false;
+            buf[0] = '\0';
+            return;
         }
+        size_t n = len < size - 1 ? (size_t)len : size - 1;
+        memcpy(buf, p, n);
+        buf[n] = '\0';
+        p += len;
     }
 
-public:
-    ~CinemaBookingSystem() {
-        delete bookingModificationStrategy;
-        for (int i = 0; i < userCount; i++) {
-            delete users[i];
+    double real() {
+        if (end - p < 8) {
+            ok = false;
+            return 0;
         }
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; i++) bits |= (uint64_t)p[i] << (8 * i);
+        p += 8;
+        double v;
+        memcpy(&v, &bits, sizeof(v));
+        return v;
     }
 
-    static CinemaBookingSystem* getInstance() {
-        if (!instance) {
-            instance = new CinemaBookingSystem();
+    int seats(int out[]) {
+        int count = integer();
+        if (count < 0 || count > MAX_TICKETS_PER_BOOKING) {
+            ok = false;
+            return 0;
         }
-        return instance;
+        for (int i = 0; i < count; i++) out[i] = integer();
+        return count;
+    }
+};
+
+// Buffers records and writes them in 64 KB blocks; the rest goes out on destruction.
+class TraceWriter {
+private:
+    FILE* file;
+    mutex lock;
+    string buffer;
+    chrono::steady_clock::time_point last;
+
+public:
+    explicit TraceWriter(FILE* f) : file(f), last(chrono::steady_clock::now()) {
+        buffer.reserve(1 << 17);
+        buffer.append(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    }
+    ~TraceWriter() {
+        fwrite(buffer.data(), 1, buffer.size(), file);
+        fclose(file);
+    }
+
+    void write(int op, bool ok, const string& payload) {
+        lock_guard<mutex> guard(lock);
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        buffer += (char)op;
+        buffer += (char)ok;
+        putVarint(buffer, (uint64_t)chrono::duration_cast<chrono::microseconds>(now - last).count());
+        putVarint(buffer, payload.size());
+        buffer += payload;
+        last = now;
+        if (buffer.size() >= (1 << 16)) {
+            fwrite(buffer.data(), 1, buffer.size(), file);
+            buffer.clear();
+        }
+    }
+};
+
+// Write-ahead journal (cinema.wal): every successful change since the last snapshot,
+// so a crash loses nothing that was confirmed. File: JOURNAL_MAGIC, the generation
+// (u64 LE) it continues from, then records of
+//   op (u8) | payload length (varint) | payload | FNV-1a of the preceding bytes (u32 LE)
+// Payloads use the trace encoding, but name the IDs a call handed out and the seats
+// it picked, so replaying them rebuilds exactly the same state. A torn last record
+// fails its checksum and is dropped.
+const char JOURNAL_MAGIC[8] = {'C', 'B', 'J', 'O', 'U', 'R', 0, 1};
+const char* const JOURNAL_FILE = "cinema.wal";
+
+uint32_t checksum(const unsigned char* p, size_t n) {
+    uint32_t h = 2166136261u;
+    while (n--) {
+        h ^= *p++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// fflush plus fsync, so the data survives a crash of the machine, not just the process.
+bool syncFile(FILE* f) {
+    if (fflush(f) != 0) return false;
+#if defined(__unix__) || defined(__APPLE__)
+    return fsync(fileno(f)) == 0;
+#elif defined(_WIN32)
+    return _commit(_fileno(f)) == 0;
+#else
+    return true;
+#endif
+}
+
+bool truncateFile(FILE* f, long long size) {
+    if (fflush(f) != 0) return false;
+#if defined(__unix__) || defined(__APPLE__)
+    return ftruncate(fileno(f), (off_t)size) == 0;
+#elif defined(_WIN32)
+    return _chsize_s(_fileno(f), size) == 0;
+#else
+    return false;
+#endif
+}
+
+// Group commit: records are appended to memory under the caller's locks, and whoever
+// then waits first writes and fsyncs everything pending while later callers queue up
+// behind it, so concurrent sellers share one fsync instead of paying one each.
+class Journal {
+private:
+    FILE* file;
+    mutex lock;
+    condition_variable flushed;
+    string pending;         // appended, not yet handed to the file
+    string writing;         // being written by the current leader
+    uint64_t appended;      // records appended so far
+    uint64_t durable;       // records known to be on disk
+    bool flushing;
+    bool syncEachCall;
+    bool failed;
+
+public:
+    explicit Journal(FILE* f) : file(f), appended(0), durable(0), flushing(false), syncEachCall(true), failed(false) {
+        pending.reserve(1 << 16);
+    }
+    ~Journal() {
+        sync();
+        fclose(file);
+    }
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Returns the record's sequence number for waitFor().
+    uint64_t append(int op, const string& payload) {
+        lock_guard<mutex> guard(lock);
+        size_t start = pending.size();
+        pending += (char)op;
+        putVarint(pending, payload.size());
+        pending += payload;
+        uint32_t sum = checksum((const unsigned char*)pending.data() + start, pending.size() - start);
+        for (int i = 0; i < 4; i++) pending += (char)(sum >> (8 * i));
+        return ++appended;
+    }
+
+    // Blocks until record `seq` is on disk, unless syncing has been left to sync().
+    void waitFor(uint64_t seq) {
+        if (syncEachCall) syncTo(seq);
+    }
+
+    void sync() {
+        uint64_t last;
+        {
+            lock_guard<mutex> guard(lock);
+            last = appended;
+        }
+        syncTo(last);
+    }
+
+    void setSyncEachCall(bool on) {
+        syncEachCall = on;
+        if (on) sync();
+    }
+
+private:
+    void syncTo(uint64_t seq) {
+        unique_lock<mutex> guard(lock);
+        while (durable < seq) {
+            if (flushing) {
+                flushed.wait(guard);
+                continue;
+            }
+            flushing = true;
+            uint64_t upTo = appended;
+            writing.swap(pending);
+            guard.unlock();
+            bool ok = fwrite(writing.data(), 1, writing.size(), file) == writing.size() && syncFile(file);
+            writing.clear();
+            guard.lock();
+            if (!ok && !failed) {
+                failed = true;
+                cerr << "Warning: cannot write " << JOURNAL_FILE << "; recent changes are only saved on exit.\n";
+            }
+            durable = upTo;
+            flushing = false;
+            flushed.notify_all();
+        }
+    }
+};
+
+// Where mutating calls report to: the optional trace, the journal, and a running
+// count of successful changes that lets an unchanged system skip rewriting its snapshot.
+struct ChangeLog {
+    TraceWriter* trace;     // null unless tracing
+    Journal* journal;       // null for standalone systems
+    atomic<long long> changes;
+    ChangeLog() : trace(nullptr), journal(nullptr), changes(0) {}
+};
+
+// One mutating call. Arguments go into args(); the destructor counts the change and
+// writes the trace record, marked ok only if the call reached succeeded(), so
+// exceptions are traced as failures. Arguments are only encoded while tracing or
+// journaling.
+//
+// succeeded() must be called with the locks that order the change still held: it
+// appends the journal record (args() unless record() built a different one), so
+// records reach the journal in the order their changes took effect. The destructor
+// runs after those locks are released and waits for the record to be on disk.
+class TraceCall {
+private:
+    TraceWriter* writer;
+    Journal* journal;
+    atomic<long long>& changes;
+    int op;
+    int recordOp;           // journal op when record() was used, else 0
+    bool ok;
+    uint64_t seq;
+    string& payload;
+    string& journalPayload;
+
+    static string& scratch(int which) {
+        static thread_local string buf[2];
+        return buf[which];
+    }
+
+public:
+    TraceCall(ChangeLog& log, int op_) : writer(log.trace), journal(log.journal), changes(log.changes), op(op_),
+                                         recordOp(0), ok(false), seq(0), payload(scratch(0)), journalPayload(scratch(1)) {
+        if (writer || journal) payload.clear();
+    }
+    ~TraceCall() {
+        if (ok) changes.fetch_add(1, memory_order_relaxed);
+        if (writer) writer->write(op, ok, payload);
+        if (seq) journal->waitFor(seq);
+    }
+    TraceCall(const TraceCall&) = delete;
+    TraceCall& operator=(const TraceCall&) = delete;
+
+    explicit operator bool() const { return writer != nullptr || journal != nullptr; }
+    string& args() { return payload; }
+
+    // Journal payload for calls whose record differs from their arguments; null
+    // unless journaling.
+    string* record(int journalOp) {
+        if (!journal) return nullptr;
+        recordOp = journalOp;
+        journalPayload.clear();
+        return &journalPayload;
+    }
+    string* record() { return record(op); }
+
+    void succeeded() {
+        ok = true;
+        if (journal) seq = recordOp ? journal->append(recordOp, journalPayload) : journal->append(op, payload);
+    }
+};
+
+// Snapshot file (cinema.snap): the whole system as fixed-size little-endian records,
+// references stored as IDs. Layout: SnapshotHeader, then the hall, movie, screening,
+// user and booking arrays back to back. Every record is a multiple of 8 bytes, so
+// each array is aligned inside a mapped file. Bump the last magic byte on any change.
+const char SNAPSHOT_MAGIC[8] = {'C', 'B', 'S', 'N', 'A', 'P', 0, 2};
+const char* const SNAPSHOT_FILE = "cinema.snap";
+
+enum SnapshotSection { SNAP_HALLS, SNAP_MOVIES, SNAP_SCREENINGS, SNAP_USERS, SNAP_BOOKINGS, SNAP_SECTIONS };
+
+struct alignas(8) SnapshotHeader {
+    char magic[8];
+    uint32_t recordSize[SNAP_SECTIONS];     // rejects files written with another layout
+    int32_t nextUserId, nextMovieId, nextScreeningId, nextBookingId;
+    uint64_t count[SNAP_SECTIONS];
+    uint64_t journalGeneration;     // only a journal of this generation replays on top
+};
+
+struct alignas(8) SnapHall {
+    char name[10];
+    int32_t rows, seatsPerRow;
+};
+
+struct alignas(8) SnapMovie {
+    int32_t id, duration;
+    char name[50];
+    char genre[20];
+    double cost;
+    int64_t bookedSeats, revenueCents;
+};
+
+struct alignas(8) SnapScreening {
+    int32_t id, movieId;
+    int32_t rows, seatsPerRow;
+    char datetime[25];
+    char hall[10];
+    uint64_t seats[SeatMap::WORDS];
+};
+
+struct alignas(8) SnapUser {
+    int32_t id;
+    char username[20];
+    char password[20];
+};
+
+struct alignas(8) SnapBooking {
+    int32_t id, userId, screeningId;
+    uint16_t seatCount;
+    uint16_t seats[MAX_TICKETS_PER_BOOKING];    // seat numbers stay below MAX_HALL_SEATS
+};
+
+// Read-only view of a whole file: mmap'd where available, otherwise read into an
+// 8-byte aligned buffer.
+class MappedFile {
+private:
+    const unsigned char* bytes;
+    size_t length;
+#if defined(__unix__) || defined(__APPLE__)
+    void* mapping;
+#else
+    vector<uint64_t> copy;
+#endif
+
+public:
+    explicit MappedFile(const char* path) : bytes(nullptr), length(0) {
+#if defined(__unix__) || defined(__APPLE__)
+        mapping = nullptr;
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                mapping = p;
+                bytes = (const unsigned char*)p;
+                length = (size_t)st.st_size;
+            }
+        }
+        close(fd);
+#else
+        FILE* f = fopen(path, "rb");
+        if (!f) return;
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        if (size > 0) {
+            copy.resize(((size_t)size + 7) / 8);
+            if (fread(copy.data(), 1, (size_t)size, f) == (size_t)size) {
+                bytes = (const unsigned char*)copy.data();
+                length = (size_t)size;
+            }
+        }
+        fclose(f);
+#endif
+    }
+    ~MappedFile() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (mapping) munmap(mapping, length);
+#endif
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return bytes != nullptr; }
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// One line of a group order: seats wanted in one screening.
+struct BookingRequest {
+    Handle<Screening> screening;
+    int seats[MAX_TICKETS_PER_BOOKING];
+    int count;
+};
+
+// Which rows a listing shows. An empty filter matches everything; from/to select
+// screenings starting in [from, to) (epochs as from makeTime).
+struct ListingFilter {
+    int movieId;          // 0 for any movie
+    char hall[10];        // "" for any hall
+    long long from, to;
+
+    ListingFilter() : movieId(0), from(LLONG_MIN), to(LLONG_MAX) { hall[0] = '\0'; }
+    bool byTime() const { return from != LLONG_MIN || to != LLONG_MAX; }
+    bool isEmpty() const { return movieId == 0 && !hall[0] && !byTime(); }
+};
+
+// Page `page` (from 0) of a listing: skips the rows of earlier pages, takes up to
+// pageSize, then notes whether one more row exists and stops the scan.
+struct Pager {
+    size_t skip;
+    size_t left;
+    bool more;
+
+    Pager(size_t page, size_t pageSize) : skip(page * pageSize), left(pageSize), more(false) {}
+    // Whether the next matching row goes on the page; false after more is set.
+    bool take() {
+        if (skip) {
+            skip--;
+            return false;
+        }
+        if (left) {
+            left--;
+            return true;
+        }
+        more = true;
+        return false;
+    }
+};
+
+void replayRecord(CinemaBookingSystem* sys, int op, TraceReader& in);
+
+typedef shared_lock<shared_mutex> ReadLock;
+typedef unique_lock<shared_mutex> WriteLock;
+
+// CinemaBookingSystem Singleton
+//
+// Thread safety: any number of sellers may call the public API concurrently.
+// Seats are claimed lock-free (CAS on seat-map words) and booking IDs come from an
+// atomic counter. Shared state is split over three reader/writer locks, always
+// taken in the order catalogMutex -> userMutex -> bookingMutex:
+//   catalogMutex  movies, screenings, halls (admin edits write, sales read)
+//   userMutex     user accounts
+//   bookingMutex  booking records, booking index and the intrusive booking lists
+// Private helpers ending in "Locked" expect the caller to hold the locks they need.
+class CinemaBookingSystem {
+private:
+    SlotMap<Movie> movies;
+    SlotMap<Screening> screenings;
+    SlotMap<Booking> bookings;
+    SlotMap<RegularUser> users;
+    SlotMap<Hall> halls;
+    HashIndex movieIndex;       // movie ID -> slot
+    HashIndex screeningIndex;   // screening ID -> slot
+    HashIndex bookingIndex;     // booking ID -> slot
+    HashIndex userIndex;        // username hash -> slot
+    HashIndex userIdIndex;      // user ID -> slot
+    HashIndex hallIndex;        // hall name hash -> slot
+    vector<HallSchedule> schedules;     // one per hall name used by a screening
+    HashIndex scheduleIndex;    // hall name hash -> index into schedules
+    mutable shared_mutex catalogMutex;
+    mutable shared_mutex userMutex;
+    mutable shared_mutex bookingMutex;
+    bool persistent;
+    int nextUserId;
+    int nextMovieId;
+    int nextScreeningId;
+    atomic<int> nextBookingId;
+    User* currentUser;
+    static CinemaBookingSystem* instance;
+    IBookingModificationStrategy* bookingModificationStrategy;
+    ChangeLog changeLog;
+    long long changesAtSnapshot;    // changeLog count when cinema.snap was last in sync
+    uint64_t journalGeneration;     // generation of cinema.wal on top of the loaded snapshot
+
+    char adminUsername[20];
+    char adminPassword[20];
+
+    // Change the CinemaBookingSystem constructor to:
+CinemaBookingSystem(bool persistent_) : movies("Movie limit reached."), screenings("Screening limit reached."),
+                        bookings("Booking limit reached."), users("User limit reached."),
+                        halls("Hall limit reached."), persistent(persistent_),
+                        nextUserId(1), nextMovieId(1), nextScreeningId(1), nextBookingId(1), currentUser(nullptr),
+                        changesAtSnapshot(0), journalGeneration(0) {
+    bookingModificationStrategy = new class BookingModificationStrategy(this);
+    strncpy(adminUsername, "ADMIN", 19); adminUsername[19] = '\0';
+    strncpy(adminPassword, "ADMIN123", 19); adminPassword[19] = '\0';
+    
+    if (persistent) {
+        // users.txt can be edited by hand, so it may hold users newer than the last
+        // snapshot. The journal then replays everything after both.
+        if (!loadSnapshot(SNAPSHOT_FILE) || isNewer("users.txt", SNAPSHOT_FILE)) loadUsersFromFile();
+        openJournal(JOURNAL_FILE);
+    }
+}
+    
+    // File load/save helpers
+    //
+    // users.txt is "username password" pairs separated by any whitespace. The file is
+    // mapped and tokenized in place, the records are created in one pass and both
+    // user indexes are then built in bulk, so millions of users load at close to
+    // disk speed. Names already in the system (restored from the snapshot) are skipped.
+    void loadUsersFromFile() {
+        MappedFile file("users.txt");
+        if (!file.isOpen()) return;
+        const char* p = (const char*)file.data();
+        const char* end = p + file.size();
+        size_t lines = 1;
+        for (const char* q = p; (q = (const char*)memchr(q, '\n', (size_t)(end - q))) != nullptr; q++) lines++;
+
+        bool merging = users.size() > 0;
+        vector<pair<uint64_t, uint32_t>> byName, byId;
+        byName.reserve(lines);
+        byId.reserve(lines);
+        char username[20], password[20];
+        try {
+            while (nextToken(p, end, username, sizeof(username)) && nextToken(p, end, password, sizeof(password))) {
+                uint64_t key = hashString(username);
+                if (merging && userIndex.find(key, [&](uint32_t slot) {
+                        return strcmp(users.at(users.handleAt(slot)).getUsername(), username) == 0;
+                    }) != NO_SLOT) continue;
+                Handle<RegularUser> h = createUserLocked(nextUserId, username, password);
+                byName.push_back(make_pair(key, h.index));
+                byId.push_back(make_pair((uint64_t)nextUserId++, h.index));
+            }
+        } catch (InputException& e) {
+            cerr << "users.txt: " << e.what() << " The remaining users were not loaded.\n";
+        }
+        userIndex.insertAll(byName);
+        userIdIndex.insertAll(byId);
+        changeLog.changes += (long long)byId.size();
+    }
+
+    // Copies the next whitespace-separated token into out (truncated like the user
+    // fields); false at the end of the data.
+    static bool isBlank(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+    static bool nextToken(const char*& p, const char* end, char* out, size_t size) {
+        while (p < end && isBlank(*p)) p++;
+        if (p == end) return false;
+        size_t n = 0;
+        for (; p < end && !isBlank(*p); p++) {
+            if (n < size - 1) out[n++] = *p;
+        }
+        out[n] = '\0';
+        return true;
+    }
+
+    Handle<RegularUser> createUserLocked(int id, const char* username, const char* password) {
+        Handle<RegularUser> h = users.insert(this, id);
+        users.at(h).setUsername(username);
+        users.at(h).setPassword(password);
+        return h;
+    }
+
+    Handle<RegularUser> insertUserLocked(int id, const char* username, const char* password) {
+        Handle<RegularUser> h = createUserLocked(id, username, password);
+        userIndex.insert(hashString(users.at(h).getUsername()), h.index);
+        userIdIndex.insert((uint64_t)id, h.index);
+        return h;
+    }
+
+    static bool isNewer(const char* path, const char* than) {
+        struct stat a, b;
+        return stat(path, &a) == 0 && (stat(than, &b) != 0 || a.st_mtime > b.st_mtime);
+    }
+
+    // Bulk-builds every store straight from the mapped records: no text parsing, and
+    // each index is sized once up front. Only used on an empty system; a damaged file
+    // leaves it empty again.
+    bool loadSnapshot(const char* path) {
+        MappedFile file(path);
+        bool ok = false;
+        try {
+            ok = loadSnapshotRecords(file);
+        } catch (InputException&) {
+            ok = false;   // a store limit was hit
+        }
+        if (!ok) {
+            bookings.clear();
+            users.clear();
+            screenings.clear();
+            movies.clear();
+            halls.clear();
+            bookingIndex.clear();
+            userIndex.clear();
+            userIdIndex.clear();
+            screeningIndex.clear();
+            movieIndex.clear();
+            hallIndex.clear();
+            schedules.clear();
+            scheduleIndex.clear();
+        }
+        return ok;
+    }
+
+    bool loadSnapshotRecords(const MappedFile& file) {
+        if (!file.isOpen() || file.size() < sizeof(SnapshotHeader)) return false;
+        const SnapshotHeader& hdr = *(const SnapshotHeader*)file.data();
+        const uint32_t sizes[SNAP_SECTIONS] = {sizeof(SnapHall), sizeof(SnapMovie), sizeof(SnapScreening),
+                                               sizeof(SnapUser), sizeof(SnapBooking)};
+        if (memcmp(hdr.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) return false;
+        const unsigned char* section[SNAP_SECTIONS];
+        uint64_t offset = sizeof(SnapshotHeader);
+        for (int i = 0; i < SNAP_SECTIONS; i++) {
+            if (hdr.recordSize[i] != sizes[i] || hdr.count[i] > (file.size() - offset) / sizes[i]) return false;
+            section[i] = file.data() + offset;
+            offset += hdr.count[i] * sizes[i];
+        }
+
+        const SnapHall* snapHalls = (const SnapHall*)section[SNAP_HALLS];
+        for (uint64_t i = 0; i < hdr.count[SNAP_HALLS]; i++) {
+            Handle<Hall> h = halls.insert(snapHalls[i].name, HallLayout(snapHalls[i].rows, snapHalls[i].seatsPerRow));
+            hallIndex.insert(hashString(halls.at(h).getName()), h.index);
+        }
+
+        const SnapMovie* snapMovies = (const SnapMovie*)section[SNAP_MOVIES];
+        movieIndex.reserve((uint32_t)hdr.count[SNAP_MOVIES]);
+        for (uint64_t i = 0; i < hdr.count[SNAP_MOVIES]; i++) {
+            const SnapMovie& r = snapMovies[i];
+            Handle<Movie> h = movies.insert(r.id, r.name, r.genre, r.duration, r.cost);
+            movies.at(h).restoreTotals(r.bookedSeats, r.revenueCents);
+            movieIndex.insert((uint64_t)r.id, h.index);
+        }
+
+        const SnapScreening* snapScreenings = (const SnapScreening*)section[SNAP_SCREENINGS];
+        screeningIndex.reserve((uint32_t)hdr.count[SNAP_SCREENINGS]);
+        for (uint64_t i = 0; i < hdr.count[SNAP_SCREENINGS]; i++) {
+            const SnapScreening& r = snapScreenings[i];
+            Handle<Movie> m = findMovieHandleLocked(r.movieId);
+            HallLayout layout(r.rows, r.seatsPerRow);
+            long long start, end;
+            if (m.isNull() || !layout.isValid() || !parseScreeningTimes(r.datetime, start, end)) return false;
+            HallSchedule& schedule = scheduleForLocked(r.hall);
+            if (schedule.conflict(start, end, NO_SLOT) != NO_SLOT) return false;
+            Handle<Screening> h = screenings.insert(r.id, m, r.datetime, start, end, r.hall, layout);
+            screenings.at(h).getSeatMap().loadWords(r.seats);
+            screeningIndex.insert((uint64_t)r.id, h.index);
+            schedule.insert(start, end, h.index);
+        }
+
+        const SnapUser* snapUsers = (const SnapUser*)section[SNAP_USERS];
+        vector<pair<uint64_t, uint32_t>> byName, byId;
+        byName.reserve((size_t)hdr.count[SNAP_USERS]);
+        byId.reserve((size_t)hdr.count[SNAP_USERS]);
+        for (uint64_t i = 0; i < hdr.count[SNAP_USERS]; i++) {
+            Handle<RegularUser> h = createUserLocked(snapUsers[i].id, snapUsers[i].username, snapUsers[i].password);
+            byName.push_back(make_pair(hashString(users.at(h).getUsername()), h.index));
+            byId.push_back(make_pair((uint64_t)snapUsers[i].id, h.index));
+        }
+        userIndex.insertAll(byName);
+        userIdIndex.insertAll(byId);
+
+        // Saved in ID order, so linking at the list heads rebuilds each user's and
+        // screening's list in its original order.
+        const SnapBooking* snapBookings = (const SnapBooking*)section[SNAP_BOOKINGS];
+        vector<pair<uint64_t, uint32_t>> bookingEntries;
+        bookingEntries.reserve((size_t)hdr.count[SNAP_BOOKINGS]);
+        for (uint64_t i = 0; i < hdr.count[SNAP_BOOKINGS]; i++) {
+            const SnapBooking& r = snapBookings[i];
+            Handle<RegularUser> u = findUserHandleByIdLocked(r.userId);
+            Handle<Screening> sc = findScreeningHandleLocked(r.screeningId);
+            if (sc.isNull() || r.seatCount == 0 || r.seatCount > MAX_TICKETS_PER_BOOKING) return false;
+            int seats[MAX_TICKETS_PER_BOOKING];
+            for (int k = 0; k < r.seatCount; k++) seats[k] = r.seats[k];
+            Handle<Booking> h = bookings.insert(r.id, u, sc, seats, (int)r.seatCount);
+            bookingEntries.push_back(make_pair((uint64_t)r.id, h.index));
+            linkBooking(h, BY_SCREENING);
+            linkBooking(h, BY_USER);
+        }
+        bookingIndex.insertAll(bookingEntries);
+
+        nextUserId = hdr.nextUserId;
+        nextMovieId = hdr.nextMovieId;
+        nextScreeningId = hdr.nextScreeningId;
+        nextBookingId.store(hdr.nextBookingId);
+        journalGeneration = hdr.journalGeneration;
+        return true;
+    }
+
+    // Replays cinema.wal if it continues the loaded snapshot, cuts off a torn last
+    // record, and keeps appending to it. A journal left over from before the last
+    // snapshot is already included in it and starts over.
+    void openJournal(const char* path) {
+        long long valid = 0;
+        {
+            MappedFile file(path);
+            const size_t HEADER = sizeof(JOURNAL_MAGIC) + 8;
+            if (file.size() >= HEADER && memcmp(file.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) == 0) {
+                uint64_t generation = 0;
+                for (int i = 0; i < 8; i++) generation |= (uint64_t)file.data()[sizeof(JOURNAL_MAGIC) + i] << (8 * i);
+                if (generation == journalGeneration) valid = (long long)(replayJournal(file.data() + HEADER, file.data() + file.size()) - file.data());
+            }
+        }
+        FILE* f = valid ? fopen(path, "r+b") : fopen(path, "wb");
+        if (!f) {
+            cerr << "Warning: cannot open " << path << "; changes are only saved on exit.\n";
+            return;
+        }
+        if (valid) {
+            truncateFile(f, valid);
+            fseek(f, 0, SEEK_END);
+        } else {
+            fwrite(JOURNAL_MAGIC, 1, sizeof(JOURNAL_MAGIC), f);
+            for (int i = 0; i < 8; i++) fputc((int)((journalGeneration >> (8 * i)) & 0xFF), f);
+        }
+        syncFile(f);
+        changeLog.journal = new Journal(f);
+    }
+
+    // Applies records up to the first incomplete or damaged one; returns where it stopped.
+    const unsigned char* replayJournal(const unsigned char* p, const unsigned char* end) {
+        TraceReader in(p, end);
+        const unsigned char* good = p;
+        while (in.p < in.end) {
+            const unsigned char* start = in.p++;
+            int op = *start;
+            uint64_t len = in.varint();
+            if (!in.ok || len > (uint64_t)(in.end - in.p) || (uint64_t)(in.end - in.p) - len < 4) break;
+            TraceReader record(in.p, in.p + len);
+            in.p += len;
+            uint32_t stored = 0;
+            for (int i = 0; i < 4; i++) stored |= (uint32_t)in.p[i] << (8 * i);
+            if (stored != checksum(start, (size_t)(in.p - start))) break;
+            in.p += 4;
+            good = in.p;
+            try {
+                applyJournalRecord(op, record);
+            } catch (InputException&) {
+                // Cannot happen for a journal written by this system; skip the record.
+            }
+        }
+        return good;
+    }
+
+    // Inserts replay under the IDs they were given. Concurrent calls can journal
+    // their IDs out of order, so the counter itself only ever moves forward.
+    template <typename Counter, typename F>
+    void withNextId(Counter& counter, int id, F insert) {
+        int high = counter;
+        counter = id;
+        try {
+            insert();
+        } catch (InputException&) {
+            counter = high;
+            throw;
+        }
+        counter = max(high, (int)counter);
+    }
+
+    // Runs before the journal is open, so replayed calls are not journaled again.
+    void applyJournalRecord(int op, TraceReader& in) {
+        switch (op) {
+        case TRACE_MOVIE:
+            withNextId(nextMovieId, in.integer(), [&] { replayRecord(this, op, in); });
+            break;
+        case TRACE_SCREENING:
+            withNextId(nextScreeningId, in.integer(), [&] { replayRecord(this, op, in); });
+            break;
+        case TRACE_BOOK:
+        case TRACE_GROUP:
+            withNextId(nextBookingId, in.integer(), [&] { replayRecord(this, op, in); });
+            break;
+        case TRACE_USER:
+            withNextId(nextUserId, in.integer(), [&] {
+                char username[20], password[20];
+                in.text(username, sizeof(username));
+                in.text(password, sizeof(password));
+                addUser(username, password);
+            });
+            break;
+        default:
+            replayRecord(this, op, in);
+        }
+    }
+
+    // Per-screening and per-user booking lists are intrusive doubly-linked lists of
+    // booking slots, so a booking joins or leaves either list in O(1).
+    uint32_t* listHead(const Booking& b, BookingList list) const {
+        if (list == BY_SCREENING) {
+            Screening* s = screenings.get(b.getScreening());
+            return s ? &s->bookingListHead() : nullptr;
+        }
+        RegularUser* u = users.get(b.getUser());
+        return u ? &u->bookingListHead() : nullptr;
+    }
+
+    void linkBooking(Handle<Booking> h, BookingList list) {
+        Booking& b = bookings.at(h);
+        uint32_t* head = listHead(b, list);
+        if (!head) return;
+        b.setLinks(list, NO_SLOT, *head);
+        if (*head != NO_SLOT) {
+            Booking& next = bookings.at(bookings.handleAt(*head));
+            next.setLinks(list, h.index, next.getNext(list));
+        }
+        *head = h.index;
+    }
+
+    void unlinkBooking(Handle<Booking> h, BookingList list) {
+        Booking& b = bookings.at(h);
+        uint32_t prev = b.getPrev(list);
+        uint32_t next = b.getNext(list);
+        if (prev != NO_SLOT) {
+            Booking& p = bookings.at(bookings.handleAt(prev));
+            p.setLinks(list, p.getPrev(list), next);
+        } else {
+            uint32_t* head = listHead(b, list);
+            if (head) *head = next;
+        }
+        if (next != NO_SLOT) {
+            Booking& n = bookings.at(bookings.handleAt(next));
+            n.setLinks(list, prev, n.getNext(list));
+        }
+        b.setLinks(list, NO_SLOT, NO_SLOT);
+    }
+
+    // Listing bodies. With stream set, out is written to stdout each LISTING_BLOCK so a
+    // full dump never holds the whole table in memory.
+    bool listMoviesLocked(Pager pager, string& out, bool stream) const {
+        const char* rule = "+----+----------------------+----------+--------+--------+\n";
+        out += rule;
+        out += "| ID | Name                 | Genre    |Duration| Cost   |\n";
+        out += rule;
+        movies.forEachWhile([&](Handle<Movie>, const Movie& m) {
+            if (!pager.take()) return !pager.more;
+            appendCell(out, m.getId(), 4);
+            out += " | ";
+            appendCell(out, m.getName(), 20);
+            appendCell(out, m.getGenre(), 10);
+            appendCell(out, m.getDuration(), 8);
+            appendMoney(out, m.getCostCents(), 8);
+            out += '\n';
+            if (stream && out.size() >= LISTING_BLOCK) writeListing(out);
+            return true;
+        });
+        out += rule;
+        return pager.more;
+    }
+
+    // f(screening) for each screening a listing covers, until f returns false. A hall
+    // or time filter goes through the hall schedules (hall by hall, in start order),
+    // otherwise screenings come in store order.
+    template <typename F>
+    void forEachListedScreeningLocked(const ListingFilter& filter, F f) const {
+        Handle<Movie> movie;
+        if (filter.movieId) {
+            movie = findMovieHandleLocked(filter.movieId);
+            if (movie.isNull()) return;
+        }
+        if (!filter.hall[0] && !filter.byTime()) {
+            screenings.forEachWhile([&](Handle<Screening>, const Screening& s) {
+                return (filter.movieId && s.getMovie() != movie) || f(s);
+            });
+            return;
+        }
+        size_t first = 0, last = schedules.size();
+        if (filter.hall[0]) {
+            uint32_t only = findScheduleLocked(filter.hall);
+            if (only == NO_SLOT) return;
+            first = only;
+            last = only + 1;
+        }
+        for (size_t i = first; i < last; i++) {
+            bool finished = schedules[i].forEachBetween(filter.from, filter.to, [&](uint32_t slot) {
+                const Screening& s = screenings.at(screenings.handleAt(slot));
+                if (s.getStartTime() < filter.from || (filter.movieId && s.getMovie() != movie)) return true;
+                return f(s);
+            });
+            if (!finished) return;
+        }
+    }
+
+    bool listScreeningsLocked(const ListingFilter& filter, Pager pager, string& out, bool stream) const {
+        const char* rule = "+----+----------------------+-----------------------------+-----------+------------------------+\n";
+        out += rule;
+        out += "| ID | Movie Name           | Date & Time                 | Hall      | Seat Capacity  |\n";
+        out += rule;
+        forEachListedScreeningLocked(filter, [&](const Screening& s) {
+            if (!pager.take()) return !pager.more;
+            // Start and end come from the stored epochs; nothing is re-parsed per row.
+            char timeRange[SCREENING_TIME_LEN + 1];
+            formatScreeningTime(s.getStartTime(), s.getEndTime(), timeRange);
+            out += '|';
+            appendCell(out, s.getId(), 4);
+            out += " | ";
+            appendCell(out, movies.at(s.getMovie()).getName(), 20);
+            out += "| ";
+            appendCell(out, timeRange, 19);
+            out += "| Cinema Hall: ";
+            out += s.getCinemaHall();
+            out += "| Seats:         ";
+            appendCell(out, s.getFreeSeatCount(), 0);
+            out += '/';
+            appendCell(out, s.getSeatCapacity(), 0);
+            out += " |\n";
+            if (stream && out.size() >= LISTING_BLOCK) writeListing(out);
+            return true;
+        });
+        out += rule;
+        return pager.more;
+    }
+
+    bool listBookingsLocked(const ListingFilter& filter, Pager pager, string& out, bool stream) const {
+        if (bookings.size() == 0) {
+            out += "No bookings available.\n";
+            return false;
+        }
+        const char* rule = "+----+------------+----------------------+---------------+---------+-------+\n";
+        out += rule;
+        out += "| ID | Username   | Movie                | Date & Time   | Seats   | Count |\n";
+        out += rule;
+        auto row = [&](const Booking& b, const Screening& s) {
+            if (!pager.take()) return !pager.more;
+            out += '|';
+            appendCell(out, b.getId(), 3);
+            out += " | ";
+            appendCell(out, users.at(b.getUser()).getUsername(), 10);
+            out += "| ";
+            appendCell(out, movies.at(s.getMovie()).getName(), 20);
+            out += "| ";
+            appendCell(out, s.getDateTime(), 14);
+            out += "| ";
+            for (int i = 0; i < b.getSeatCount(); i++) {
+                if (i) out += ',';
+                appendCell(out, b.getSeats()[i], 0);
+            }
+            out.append(max(1, 7 - b.getSeatCount()), ' ');
+            out += "| ";
+            appendCell(out, b.getSeatCount(), 5);
+            out += " |\n";
+            if (stream && out.size() >= LISTING_BLOCK) writeListing(out);
+            return true;
+        };
+        if (filter.isEmpty()) {
+            bookings.forEachWhile([&](Handle<Booking>, const Booking& b) { return row(b, screenings.at(b.getScreening())); });
+        } else {
+            forEachListedScreeningLocked(filter, [&](const Screening& s) {
+                for (uint32_t slot = s.getFirstBooking(); slot != NO_SLOT;) {
+                    const Booking& b = bookings.at(bookings.handleAt(slot));
+                    if (!row(b, s)) return false;
+                    slot = b.getNext(BY_SCREENING);
+                }
+                return true;
+            });
+        }
+        out += rule;
+        return pager.more;
+    }
+
+    void recordSale(Handle<Screening> screening, int seatDelta) {
+        Screening* s = screenings.get(screening);
+        Movie* m = s ? movies.get(s->getMovie()) : nullptr;
+        if (m) m->recordSale(seatDelta);
+    }
+
+    void saveUsersToFile() {
+        if (!persistent) return;
+        ofstream outFile("users.txt");
+        if (outFile.is_open()) {
+            users.forEach([&](Handle<RegularUser>, const RegularUser& u) {
+                outFile << u.getUsername() << " " << u.getPassword() << "\n";
+            });
+            outFile.close();
+        }
+    }
+
+    Handle<Movie> findMovieHandleLocked(int id) const {
+        return movies.handleAt(movieIndex.find((uint64_t)id));
+    }
+
+    Handle<Screening> findScreeningHandleLocked(int id) const {
+        return screenings.handleAt(screeningIndex.find((uint64_t)id));
+    }
+
+    Handle<RegularUser> findUserHandleByIdLocked(int id) const {
+        return users.handleAt(userIdIndex.find((uint64_t)id));
+    }
+
+    Handle<Booking> findBookingHandleLocked(int id) const {
+        return bookings.handleAt(bookingIndex.find((uint64_t)id));
+    }
+
+    Hall* findHallLocked(const char* name) const {
+        uint32_t slot = hallIndex.find(hashString(name), [&](uint32_t candidate) {
+            return strcmp(halls.at(halls.handleAt(candidate)).getName(), name) == 0;
+        });
+        return halls.get(halls.handleAt(slot));
+    }
+
+    // Unregistered halls get the default 10 x 15 plan.
+    HallLayout layoutForHallLocked(const char* name) const {
+        Hall* h = findHallLocked(name);
+        return h ? h->getLayout() : HallLayout();
+    }
+
+    // Schedules exist for registered and unregistered hall names alike. Names are
+    // compared as a Screening stores them (at most 9 characters).
+    uint32_t findScheduleLocked(const char* hall) const {
+        char name[10];
+        strncpy(name, hall, 9); name[9] = '\0';
+        return scheduleIndex.find(hashString(name), [&](uint32_t candidate) {
+            return strcmp(schedules[candidate].getName(), name) == 0;
+        });
+    }
+
+    HallSchedule& scheduleForLocked(const char* hall) {
+        uint32_t i = findScheduleLocked(hall);
+        if (i != NO_SLOT) return schedules[i];
+        schedules.push_back(HallSchedule(hall));
+        scheduleIndex.insert(hashString(schedules.back().getName()), (uint32_t)schedules.size() - 1);
+        return schedules.back();
+    }
+
+    // Throws unless [start, end) in `hall` is free, ignoring screening slot `except`.
+    void checkHallFreeLocked(const char* hall, long long start, long long end, uint32_t except) {
+        uint32_t clash = scheduleForLocked(hall).conflict(start, end, except);
+        if (clash != NO_SLOT) {
+            throw InputException("Hall " + string(hall) + " is already in use by screening " +
+                                 to_string(screenings.at(screenings.handleAt(clash)).getId()) + " at that time.");
+        }
+    }
+
+    // Seats must already be claimed in the screening's seat map. Needs catalog and
+    // user read locks plus the booking write lock.
+    Handle<Booking> insertBookingLocked(int id, Handle<RegularUser> user, Handle<Screening> screening, const int seats[], int count) {
+        Handle<Booking> h = bookings.insert(id, user, screening, seats, count);
+        bookingIndex.insert((uint64_t)id, h.index);
+        linkBooking(h, BY_SCREENING);
+        linkBooking(h, BY_USER);
+        recordSale(screening, count);
+        return h;
+    }
+
+    // O(1) apart from releasing the seats: the slot is tombstoned and put on the free
+    // list instead of shifting later bookings down.
+    void cancelBookingLocked(Handle<Booking> h) {
+        Booking* b = bookings.get(h);
+        if (!b) return;
+        Screening* s = screenings.get(b->getScreening());
+        if (s) s->cancelSeats(b->getSeats(), b->getSeatCount());
+        recordSale(b->getScreening(), -b->getSeatCount());
+        unlinkBooking(h, BY_SCREENING);
+        unlinkBooking(h, BY_USER);
+        bookingIndex.erase((uint64_t)b->getId(), h.index);
+        bookings.erase(h);
+    }
+
+    // Trace helpers; take their own read locks, so call before locking.
+    int userIdOf(Handle<RegularUser> h) const {
+        ReadLock lock(userMutex);
+        RegularUser* u = users.get(h);
+        return u ? u->getId() : 0;
+    }
+
+    int screeningIdOf(Handle<Screening> h) const {
+        ReadLock lock(catalogMutex);
+        Screening* s = screenings.get(h);
+        return s ? s->getId() : 0;
+    }
+
+    static void traceMovie(string& out, const char* name, const char* genre, int duration, double cost) {
+        putString(out, name);
+        putString(out, genre);
+        putVarint(out, (uint64_t)duration);
+        putDouble(out, cost);
+    }
+
+    static void traceScreening(string& out, int movieId, const char* datetime, const char* hall) {
+        putVarint(out, (uint64_t)movieId);
+        putString(out, datetime);
+        putString(out, hall);
+    }
+
+    // Needs the catalog write lock.
+    void deleteScreeningLocked(Handle<Screening> h) {
+        // Pulling a show refunds only its own bookings: O(bookings for this screening).
+        {
+            ReadLock userLock(userMutex);
+            WriteLock bookingLock(bookingMutex);
+            Screening& s = screenings.at(h);
+            while (s.getFirstBooking() != NO_SLOT) {
+                cancelBookingLocked(bookings.handleAt(s.getFirstBooking()));
+            }
+        }
+        Screening& s = screenings.at(h);
+        schedules[findScheduleLocked(s.getCinemaHall())].erase(s.getStartTime());
+        screeningIndex.erase((uint64_t)s.getId(), h.index);
+        screenings.erase(h);
+    }
+
+public:
+    // Once the snapshot holds everything, the journal is no longer needed. If the exit
+    // stops between the two, the journal's generation no longer matches and is ignored.
+    ~CinemaBookingSystem() {
+        if (persistent && changeLog.changes.load() != changesAtSnapshot) {
+            if (changeLog.journal) changeLog.journal->sync();
+            saveUsersToFile();   // before the snapshot, so it is not newer than it
+            if (saveSnapshot(SNAPSHOT_FILE)) {
+                delete changeLog.journal;
+                changeLog.journal = nullptr;
+                remove(JOURNAL_FILE);
+            }
+        }
+        delete changeLog.journal;
+        delete changeLog.trace;
+        delete bookingModificationStrategy;
+    }
+
+    // Writes the whole system to a temporary file and renames it over path, so a crash
+    // mid-save leaves the previous snapshot intact.
+    bool saveSnapshot(const char* path) const {
+        ReadLock catalogLock(catalogMutex);
+        ReadLock userLock(userMutex);
+        ReadLock bookingLock(bookingMutex);
+        string tmp = string(path) + ".tmp";
+        FILE* f = fopen(tmp.c_str(), "wb");
+        if (!f) return false;
+        setvbuf(f, nullptr, _IOFBF, 1 << 20);
+
+        SnapshotHeader hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        hdr.recordSize[SNAP_HALLS] = sizeof(SnapHall);
+        hdr.recordSize[SNAP_MOVIES] = sizeof(SnapMovie);
+        hdr.recordSize[SNAP_SCREENINGS] = sizeof(SnapScreening);
+        hdr.recordSize[SNAP_USERS] = sizeof(SnapUser);
+        hdr.recordSize[SNAP_BOOKINGS] = sizeof(SnapBooking);
+        hdr.nextUserId = nextUserId;
+        hdr.nextMovieId = nextMovieId;
+        hdr.nextScreeningId = nextScreeningId;
+        hdr.nextBookingId = nextBookingId.load();
+        hdr.journalGeneration = journalGeneration + 1;
+        hdr.count[SNAP_HALLS] = halls.size();
+        hdr.count[SNAP_MOVIES] = movies.size();
+        hdr.count[SNAP_SCREENINGS] = screenings.size();
+        hdr.count[SNAP_USERS] = users.size();
+        hdr.count[SNAP_BOOKINGS] = bookings.size();
+        fwrite(&hdr, sizeof(hdr), 1, f);
+
+        halls.forEach([&](Handle<Hall>, const Hall& h) {
+            SnapHall r;
+            memset(&r, 0, sizeof(r));
+            strncpy(r.name, h.getName(), sizeof(r.name) - 1);
+            r.rows = h.getLayout().rows;
+            r.seatsPerRow = h.getLayout().seatsPerRow;
+            fwrite(&r, sizeof(r), 1, f);
+        });
+        movies.forEach([&](Handle<Movie>, const Movie& m) {
+            SnapMovie r;
+            memset(&r, 0, sizeof(r));
+            r.id = m.getId();
+            r.duration = m.getDuration();
+            strncpy(r.name, m.getName(), sizeof(r.name) - 1);
+            strncpy(r.genre, m.getGenre(), sizeof(r.genre) - 1);
+            r.cost = m.getCost();
+            r.bookedSeats = m.getBookedSeats();
+            r.revenueCents = m.getRevenueCents();
+            fwrite(&r, sizeof(r), 1, f);
+        });
+        screenings.forEach([&](Handle<Screening>, const Screening& s) {
+            SnapScreening r;
+            memset(&r, 0, sizeof(r));
+            r.id = s.getId();
+            r.movieId = movies.at(s.getMovie()).getId();
+            r.rows = s.getLayout().rows;
+            r.seatsPerRow = s.getLayout().seatsPerRow;
+            strncpy(r.datetime, s.getDateTime(), sizeof(r.datetime) - 1);
+            strncpy(r.hall, s.getCinemaHall(), sizeof(r.hall) - 1);
+            s.getSeatMap().copyWords(r.seats);
+            fwrite(&r, sizeof(r), 1, f);
+        });
+        users.forEach([&](Handle<RegularUser>, const RegularUser& u) {
+            SnapUser r;
+            memset(&r, 0, sizeof(r));
+            r.id = u.getId();
+            strncpy(r.username, u.getUsername(), sizeof(r.username) - 1);
+            strncpy(r.password, u.getPassword(), sizeof(r.password) - 1);
+            fwrite(&r, sizeof(r), 1, f);
+        });
+        // Bookings go out in ID order (slots are reused, so slot order is not).
+        vector<uint32_t> order;
+        order.reserve(bookings.size());
+        bookings.forEach([&](Handle<Booking> h, const Booking&) { order.push_back(h.index); });
+        sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return bookings.at(bookings.handleAt(a)).getId() < bookings.at(bookings.handleAt(b)).getId();
+        });
+        for (uint32_t slot : order) {
+            const Booking& b = bookings.at(bookings.handleAt(slot));
+            SnapBooking r;
+            memset(&r, 0, sizeof(r));
+            r.id = b.getId();
+            RegularUser* u = users.get(b.getUser());
+            r.userId = u ? u->getId() : 0;
+            r.screeningId = screenings.at(b.getScreening()).getId();
+            r.seatCount = (uint16_t)b.getSeatCount();
+            for (int i = 0; i < b.getSeatCount(); i++) r.seats[i] = (uint16_t)b.getSeats()[i];
+            fwrite(&r, sizeof(r), 1, f);
+        }
+
+        bool ok = !ferror(f);
+        ok = fclose(f) == 0 && ok;
+#ifdef _WIN32
+        if (ok) remove(path);   // rename() does not replace an existing file on Windows
+#endif
+        return ok && rename(tmp.c_str(), path) == 0;
+    }
+
+    // Starts recording every mutating call to path. Users that already exist (loaded
+    // from users.txt) are written first so the trace replays onto an empty system.
+    // Call before other threads start using the system.
+    bool startTrace(const char* path) {
+        FILE* f = fopen(path, "wb");
+        if (!f) return false;
+        delete changeLog.trace;
+        changeLog.trace = new TraceWriter(f);
+        ReadLock lock(userMutex);
+        string payload;
+        users.forEach([&](Handle<RegularUser>, const RegularUser& u) {
+            payload.clear();
+            putString(payload, u.getUsername());
+            changeLog.trace->write(TRACE_USER, true, payload);
+        });
+        return true;
+    }
+
+    void stopTrace() {
+        delete changeLog.trace;
+        changeLog.trace = nullptr;
+    }
+
+    static CinemaBookingSystem* getInstance() {
+        static once_flag created;
+        call_once(created, [] { instance = new CinemaBookingSystem(true); });
+        return instance;
+    }
+
+    // Empty system that never touches users.txt, for benchmarks and other tools.
+    static CinemaBookingSystem* createStandalone() {
+        return new CinemaBookingSystem(false);
     }
 
     bool validateAdmin(const char* user, const char* pass) {
@@ -391,249 +2419,528 @@ public:
     }
 
      void saveUsersToFilePublic() {
+        ReadLock lock(userMutex);
         saveUsersToFile();
     }
-    void addMovie(const char* name, const char* genre, int duration, double cost) {
-        if (movieCount >= MAX_MOVIES) throw InputException("Movie limit reached.");
-        int newId = movieCount + 1;
-        movies[movieCount++] = Movie(newId, name, genre, duration, cost);
+
+    // By default a change is on disk before its call returns. Batch runs turn that off
+    // and call syncJournal() before answers go out, sharing one fsync per block.
+    void setSyncEachCall(bool on) {
+        if (changeLog.journal) changeLog.journal->setSyncEachCall(on);
+    }
+
+    void syncJournal() {
+        if (changeLog.journal) changeLog.journal->sync();
+    }
+
+    // Returned pointers stay valid until the record is deleted.
+    Movie* getMovie(Handle<Movie> h) const { ReadLock lock(catalogMutex); return movies.get(h); }
+    Screening* getScreening(Handle<Screening> h) const { ReadLock lock(catalogMutex); return screenings.get(h); }
+    Booking* getBooking(Handle<Booking> h) const { ReadLock lock(bookingMutex); return bookings.get(h); }
+    RegularUser* getUser(Handle<RegularUser> h) const { ReadLock lock(userMutex); return users.get(h); }
+
+    int addMovie(const char* name, const char* genre, int duration, double cost) {
+        TraceCall call(changeLog, TRACE_MOVIE);
+        if (call) traceMovie(call.args(), name, genre, duration, cost);
+        WriteLock lock(catalogMutex);
+        Handle<Movie> h = movies.insert(nextMovieId, name, genre, duration, cost);
+        movieIndex.insert((uint64_t)nextMovieId, h.index);
+        if (string* rec = call.record()) {
+            putVarint(*rec, (uint64_t)nextMovieId);
+            rec->append(call.args());
+        }
+        call.succeeded();
+        return nextMovieId++;
     }
 
     void editMovie(int id, const char* name, const char* genre, int duration, double cost) {
-        Movie* m = findMovieById(id);
+        TraceCall call(changeLog, TRACE_EDIT_MOVIE);
+        if (call) {
+            putVarint(call.args(), (uint64_t)id);
+            traceMovie(call.args(), name, genre, duration, cost);
+        }
+        WriteLock lock(catalogMutex);
+        Movie* m = movies.get(findMovieHandleLocked(id));
         if (!m) throw InputException("Movie not found.");
         m->setName(name);
         m->setGenre(genre);
         m->setDuration(duration);
         m->setCost(cost);
+        call.succeeded();
     }
 
     void deleteMovie(int id) {
-        int idx = -1;
-        for (int i = 0; i < movieCount; i++) {
-            if (movies[i].getId() == id) {
-                idx = i;
-                break;
-            }
-        }
-        if (idx == -1) throw InputException("Movie not found.");
+        TraceCall call(changeLog, TRACE_DELETE_MOVIE);
+        if (call) putVarint(call.args(), (uint64_t)id);
+        WriteLock lock(catalogMutex);
+        Handle<Movie> h = findMovieHandleLocked(id);
+        if (h.isNull()) throw InputException("Movie not found.");
         
-        for (int i = 0; i < screeningCount;) {
-            if (screenings[i].getMovie()->getId() == id) {
-                deleteScreening(screenings[i].getId());
-            } else {
-                i++;
-            }
-        }
+        screenings.forEach([&](Handle<Screening> sh, const Screening& s) {
+            if (s.getMovie() == h) deleteScreeningLocked(sh);
+        });
         
-        for (int i = idx; i < movieCount - 1; i++) {
-            movies[i] = movies[i + 1];
+        movieIndex.erase((uint64_t)id, h.index);
+        movies.erase(h);
+        call.succeeded();
+    }
+
+    // f(movie) runs under the catalog read lock and must not call back into the system.
+    template <typename F>
+    void forEachMovie(F f) const {
+        ReadLock lock(catalogMutex);
+        movies.forEach([&](Handle<Movie>, const Movie& m) { f(m); });
+    }
+
+    // Page `page` of the movie table, appended to out; true if a later page exists.
+    bool listMovies(size_t page, size_t pageSize, string& out) const {
+        ReadLock lock(catalogMutex);
+        return listMoviesLocked(Pager(page, pageSize), out, false);
+    }
+
+    void displayMovies() const {
+        static thread_local string out;
+        ReadLock lock(catalogMutex);
+        listMoviesLocked(Pager(0, SIZE_MAX), out, true);
+        writeListing(out);
+    }
+
+    Handle<Movie> findMovieHandleById(int id) const {
+        ReadLock lock(catalogMutex);
+        return findMovieHandleLocked(id);
+    }
+
+    Movie* findMovieById(int id) const {
+        ReadLock lock(catalogMutex);
+        return movies.get(findMovieHandleLocked(id));
+    }
+
+    // Adds a hall or changes the seating plan used by its future screenings.
+    void registerHall(const char* name, int rows, int seatsPerRow) {
+        TraceCall call(changeLog, TRACE_HALL);
+        if (call) {
+            putString(call.args(), name);
+            putVarint(call.args(), (uint64_t)rows);
+            putVarint(call.args(), (uint64_t)seatsPerRow);
         }
-        movieCount--;
+        HallLayout layout(rows, seatsPerRow);
+        if (!layout.isValid()) throw InputException("Invalid hall layout.");
+        WriteLock lock(catalogMutex);
+        Hall* existing = findHallLocked(name);
+        if (existing) {
+            existing->setLayout(layout);
+        } else {
+            Handle<Hall> h = halls.insert(name, layout);
+            hallIndex.insert(hashString(halls.at(h).getName()), h.index);
+        }
+        call.succeeded();
+    }
+
+    Hall* findHall(const char* name) const {
+        ReadLock lock(catalogMutex);
+        return findHallLocked(name);
+    }
+
+int addScreening(int movieId, const char* datetime, const char* hall) {
+    TraceCall call(changeLog, TRACE_SCREENING);
+    if (call) traceScreening(call.args(), movieId, datetime, hall);
+    WriteLock lock(catalogMutex);
+    Handle<Movie> m = findMovieHandleLocked(movieId);
+    if (m.isNull()) throw InputException("Movie not found for screening.");
+    
+    // Ensure datetime is formatted correctly
+    long long start, end;
+    if (!parseScreeningTimes(datetime, start, end)) {
+        throw InputException("Invalid datetime format.");
+    }
+    checkHallFreeLocked(hall, start, end, NO_SLOT);
+
+    Handle<Screening> h = screenings.insert(nextScreeningId, m, datetime, start, end, hall, layoutForHallLocked(hall));
+    screeningIndex.insert((uint64_t)nextScreeningId, h.index);
+    scheduleForLocked(hall).insert(start, end, h.index);
+    if (string* rec = call.record()) {
+        putVarint(*rec, (uint64_t)nextScreeningId);
+        rec->append(call.args());
+    }
+    call.succeeded();
+    return nextScreeningId++;
+}
+
+
+    void editScreening(int id, int movieId, const char* datetime, const char* hall) {
+        TraceCall call(changeLog, TRACE_EDIT_SCREENING);
+        if (call) {
+            putVarint(call.args(), (uint64_t)id);
+            traceScreening(call.args(), movieId, datetime, hall);
+        }
+        WriteLock lock(catalogMutex);
+        Screening* s = screenings.get(findScreeningHandleLocked(id));
+        if (!s) throw InputException("Screening not found.");
+        Handle<Movie> m = findMovieHandleLocked(movieId);
+        if (m.isNull()) throw InputException("Movie not found for screening.");
+        long long start, end;
+        if (!parseScreeningTimes(datetime, start, end)) throw InputException("Invalid datetime format.");
+        Handle<Screening> h = findScreeningHandleLocked(id);
+        checkHallFreeLocked(hall, start, end, h.index);
+        Handle<Movie> oldMovie = s->getMovie();
+        HallSchedule& oldSchedule = schedules[findScheduleLocked(s->getCinemaHall())];
+        long long oldStart = s->getStartTime();
+        s->reschedule(m, datetime, start, end, hall, layoutForHallLocked(hall));
+        oldSchedule.erase(oldStart);
+        scheduleForLocked(hall).insert(start, end, h.index);
+        if (oldMovie != m) {
+            // Sold seats follow the screening to its new movie.
+            int sold = s->getSeatCapacity() - s->getFreeSeatCount();
+            if (Movie* old = movies.get(oldMovie)) old->recordSale(-sold);
+            movies.at(m).recordSale(sold);
+        }
+        call.succeeded();
+    }
+
+    void deleteScreening(int id) {
+        TraceCall call(changeLog, TRACE_DELETE_SCREENING);
+        if (call) putVarint(call.args(), (uint64_t)id);
+        WriteLock lock(catalogMutex);
+        Handle<Screening> h = findScreeningHandleLocked(id);
+        if (h.isNull()) throw InputException("Screening not found.");
+        deleteScreeningLocked(h);
+        call.succeeded();
+    }
+
+    // Page `page` of the screenings matching filter, appended to out; true if a later
+    // page exists.
+    bool listScreenings(const ListingFilter& filter, size_t page, size_t pageSize, string& out) const {
+        ReadLock lock(catalogMutex);
+        return listScreeningsLocked(filter, Pager(page, pageSize), out, false);
+    }
+
+    void displayScreenings() const {
+        static thread_local string out;
+        ReadLock lock(catalogMutex);
+        listScreeningsLocked(ListingFilter(), Pager(0, SIZE_MAX), out, true);
+        writeListing(out);
+    }
+
+    Handle<Screening> findScreeningHandleById(int id) const {
+        ReadLock lock(catalogMutex);
+        return findScreeningHandleLocked(id);
+    }
+
+    // What is showing in [from, to) (times as from parseScreeningTimes), hall by hall
+    // in start order; hall null means every hall. O(log n + k) per hall.
+    // f(screening, movie) runs under the catalog read lock and must not call back into
+    // the system.
+    template <typename F>
+    void forEachScreeningBetween(long long from, long long to, const char* hall, F f) const {
+        ReadLock lock(catalogMutex);
+        size_t first = 0, last = schedules.size();
+        if (hall) {
+            uint32_t only = findScheduleLocked(hall);
+            if (only == NO_SLOT) return;
+            first = only;
+            last = only + 1;
+        }
+        for (size_t i = first; i < last; i++) {
+            schedules[i].forEachBetween(from, to, [&](uint32_t slot) {
+                const Screening& s = screenings.at(screenings.handleAt(slot));
+                f(s, movies.at(s.getMovie()));
+                return true;
+            });
+        }
+    }
+
+    Screening* findScreeningById(int id) const {
+        ReadLock lock(catalogMutex);
+        return screenings.get(findScreeningHandleLocked(id));
+    }
+
+    Handle<RegularUser> addUser(const char* username, const char* password) {
+        TraceCall call(changeLog, TRACE_USER);
+        if (call) putString(call.args(), username);
+        WriteLock lock(userMutex);
+        Handle<RegularUser> h = insertUserLocked(nextUserId, username, password);
+        if (string* rec = call.record()) {
+            putVarint(*rec, (uint64_t)nextUserId);
+            putString(*rec, username);
+            putString(*rec, password);
+        }
+        nextUserId++;
+        call.succeeded();
+        return h;
+    }
+
+    Handle<RegularUser> findUserHandleByUsername(const char* username) const {
+        ReadLock lock(userMutex);
+        uint32_t slot = userIndex.find(hashString(username), [&](uint32_t candidate) {
+            return strcmp(users.at(users.handleAt(candidate)).getUsername(), username) == 0;
+        });
+        return users.handleAt(slot);
+    }
+
+    RegularUser* findUserByUsername(const char* username) const {
+        Handle<RegularUser> h = findUserHandleByUsername(username);
+        ReadLock lock(userMutex);
+        return users.get(h);
     }
 
-    void displayMovies() const {
-        cout << "+----+----------------------+----------+--------+--------+\n";
-        cout << "| ID | Name                 | Genre    |Duration| Cost   |\n";
-        cout << "+----+----------------------+----------+--------+--------+\n";
-        for (int i = 0; i < movieCount; i++) {
-            movies[i].display();
-        }
-        cout << "+----+----------------------+----------+--------+--------+\n";
+    Handle<RegularUser> findUserHandleById(int id) const {
+        ReadLock lock(userMutex);
+        return findUserHandleByIdLocked(id);
     }
 
-    Movie* findMovieById(int id) const {
-        for (int i = 0; i < movieCount; i++) {
-            if (movies[i].getId() == id) return const_cast<Movie*>(&movies[i]);
+    // Walks one user's bookings oldest first: O(that user's bookings). New bookings are
+    // pushed at the head, so start from the tail and follow the prev links.
+    // f(handle, booking, screening, movie) runs under the read locks and must not call
+    // back into the system.
+    template <typename F>
+    void forEachBookingOfUser(int userId, F f) const {
+        ReadLock catalogLock(catalogMutex);
+        ReadLock userLock(userMutex);
+        ReadLock bookingLock(bookingMutex);
+        RegularUser* u = users.get(findUserHandleByIdLocked(userId));
+        if (!u || u->bookingListHead() == NO_SLOT) return;
+        uint32_t slot = u->bookingListHead();
+        while (bookings.at(bookings.handleAt(slot)).getNext(BY_USER) != NO_SLOT) {
+            slot = bookings.at(bookings.handleAt(slot)).getNext(BY_USER);
+        }
+        while (slot != NO_SLOT) {
+            Handle<Booking> h = bookings.handleAt(slot);
+            const Booking& b = bookings.at(h);
+            slot = b.getPrev(BY_USER);
+            const Screening& s = screenings.at(b.getScreening());
+            f(h, b, s, movies.at(s.getMovie()));
         }
-        return nullptr;
     }
 
-void addScreening(int movieId, const char* datetime, const char* hall) {
-    if (screeningCount >= MAX_SCREENINGS) throw InputException("Screening limit reached.");
-    Movie* m = findMovieById(movieId);
-    if (!m) throw InputException("Movie not found for screening.");
-    
-    // Ensure datetime is formatted correctly
-    if (strlen(datetime) < 16) {
-        throw InputException("Invalid datetime format.");
+    // Seats are claimed lock-free in the seat map first; only the record insert
+    // takes the booking write lock.
+    Handle<Booking> addBooking(Handle<RegularUser> user, Handle<Screening> screening, const int seats[], int count) {
+        TraceCall call(changeLog, TRACE_BOOK);
+        if (call) {
+            putVarint(call.args(), (uint64_t)userIdOf(user));
+            putVarint(call.args(), (uint64_t)screeningIdOf(screening));
+            putSeats(call.args(), seats, count);
+        }
+        ReadLock catalogLock(catalogMutex);
+        Screening* s = screenings.get(screening);
+        if (!s) throw InputException("Screening not found.");
+        if (count <= 0 || count > MAX_TICKETS_PER_BOOKING) throw InputException("Invalid number of tickets.");
+        if (!s->bookSeats(seats, count)) throw InputException("Some seats are already booked or invalid.");
+        int id = nextBookingId.fetch_add(1);
+        ReadLock userLock(userMutex);
+        WriteLock bookingLock(bookingMutex);
+        Handle<Booking> h = insertBookingLocked(id, user, screening, seats, count);
+        if (string* rec = call.record()) {
+            putVarint(*rec, (uint64_t)id);
+            rec->append(call.args());
+        }
+        call.succeeded();
+        return h;
     }
 
-    int newId = screeningCount + 1;
-    screenings[screeningCount++] = Screening(newId, m, datetime, hall);
-}
-
-
-    void editScreening(int id, int movieId, const char* datetime, const char* hall) {
-        Screening* s = findScreeningById(id);
+    // "Seats together" sale: picks the best contiguous block and books it. Another
+    // seller can take part of the block between the search and the claim, so retry.
+    Handle<Booking> addBestAvailableBooking(Handle<RegularUser> user, Handle<Screening> screening, int count) {
+        TraceCall call(changeLog, TRACE_BEST);
+        if (call) {
+            putVarint(call.args(), (uint64_t)userIdOf(user));
+            putVarint(call.args(), (uint64_t)screeningIdOf(screening));
+            putVarint(call.args(), (uint64_t)count);
+        }
+        ReadLock catalogLock(catalogMutex);
+        Screening* s = screenings.get(screening);
         if (!s) throw InputException("Screening not found.");
-        Movie* m = findMovieById(movieId);
-        if (!m) throw InputException("Movie not found for screening.");
-        *s = Screening(id, m, datetime, hall);
+        if (count <= 0 || count > MAX_TICKETS_PER_BOOKING) throw InputException("Invalid number of tickets.");
+        int seats[MAX_TICKETS_PER_BOOKING];
+        for (int attempt = 0;; attempt++) {
+            if (!s->findBestBlock(count, seats)) throw InputException("No block of that many seats together is free.");
+            if (s->bookSeats(seats, count)) break;
+            if (attempt == 100) throw InputException("Seats are selling too fast, please try again.");
+        }
+        int id = nextBookingId.fetch_add(1);
+        ReadLock userLock(userMutex);
+        WriteLock bookingLock(bookingMutex);
+        Handle<Booking> h = insertBookingLocked(id, user, screening, seats, count);
+        if (string* rec = call.record(TRACE_BOOK)) {   // replays as the seats it picked
+            RegularUser* u = users.get(user);
+            putVarint(*rec, (uint64_t)id);
+            putVarint(*rec, u ? (uint64_t)u->getId() : 0);
+            putVarint(*rec, (uint64_t)s->getId());
+            putSeats(*rec, seats, count);
+        }
+        call.succeeded();
+        return h;
     }
 
-    void deleteScreening(int id) {
-        int idx = -1;
-        for (int i = 0; i < screeningCount; i++) {
-            if (screenings[i].getId() == id) {
-                idx = i;
-                break;
+    // Group order: every request is booked or none is. All seat maps are checked
+    // before any is touched; the claims are then made in order and handed back if a
+    // concurrent sale wins a seat in between. The whole batch takes one block of
+    // booking IDs, one index resize and one booking-lock section.
+    vector<Handle<Booking>> addBookingBatch(Handle<RegularUser> user, const vector<BookingRequest>& requests) {
+        TraceCall call(changeLog, TRACE_GROUP);
+        if (call) {
+            putVarint(call.args(), (uint64_t)userIdOf(user));
+            putVarint(call.args(), requests.size());
+            for (const BookingRequest& r : requests) {
+                putVarint(call.args(), (uint64_t)screeningIdOf(r.screening));
+                putSeats(call.args(), r.seats, r.count);
             }
         }
-        if (idx == -1) throw InputException("Screening not found.");
-        
-        for (int i = 0; i < bookingCount;) {
-            if (bookings[i].getScreening()->getId() == id) {
-                cancelBookingByIndex(i);
-            } else {
-                i++;
-            }
+        ReadLock catalogLock(catalogMutex);
+        if (requests.empty()) throw InputException("Empty batch.");
+        for (size_t i = 0; i < requests.size(); i++) {
+            const BookingRequest& r = requests[i];
+            Screening* s = screenings.get(r.screening);
+            string item = "Batch item " + to_string(i + 1) + ": ";
+            if (!s) throw InputException(item + "screening not found.");
+            if (r.count <= 0 || r.count > MAX_TICKETS_PER_BOOKING) throw InputException(item + "invalid number of tickets.");
+            if (!s->seatsAvailable(r.seats, r.count)) throw InputException(item + "some seats are already booked or invalid.");
         }
-        
-        for (int i = idx; i < screeningCount - 1; i++) {
-            screenings[i] = screenings[i + 1];
+        size_t claimed = 0;
+        while (claimed < requests.size()) {
+            const BookingRequest& r = requests[claimed];
+            if (!screenings.at(r.screening).bookSeats(r.seats, r.count)) break;
+            claimed++;
         }
-        screeningCount--;
-    }
-
-void displayScreenings() const {
-    cout << "+----+----------------------+-----------------------------+-----------+------------------------+\n";
-    cout << "| ID | Movie Name           | Date & Time                 | Hall      | Seat Capacity  |\n";
-    cout << "+----+----------------------+-----------------------------+-----------+------------------------+\n";
-    for (int i = 0; i < screeningCount; i++) {
-        string dateTimeStr(screenings[i].getDateTime());
-
-        // Extract start and end times
-        string startTime, endTime;
-        size_t dashPos = dateTimeStr.find(" - ");
-        if (dashPos != string::npos) {
-            startTime = dateTimeStr.substr(0, dashPos); // Get the start time
-            endTime = dateTimeStr.substr(dashPos + 3); // Get the end time (after " - ")
-        } else {
-            startTime = "Invalid Date"; // Fallback for invalid date
-            endTime = "Invalid Time"; // Fallback for invalid time
+        if (claimed < requests.size()) {
+            for (size_t i = 0; i < claimed; i++) {
+                screenings.at(requests[i].screening).cancelSeats(requests[i].seats, requests[i].count);
+            }
+            throw InputException("Batch item " + to_string(claimed + 1) + ": seats overlap another item or were just sold.");
         }
 
-        // Displaying the screening information
-        cout << "|" << setw(4) << screenings[i].getId() << " "
-             << "| " << setw(20) << left << screenings[i].getMovie()->getName()
-             << "| " << setw(19) << left << startTime + " - " + endTime // Displaying only the relevant time range
-             << "| " << setw(5) << "Cinema Hall: " <<screenings[i].getCinemaHall()
-             << "| " << setw(15) << "Seats: " << screenings[i].getSeatCapacity() << " |\n";
-    }
-    cout << "+----+----------------------+-----------------------------+-----------+------------------------+\n";
-}
-
-    Screening* findScreeningById(int id) const {
-        for (int i = 0; i < screeningCount; i++) {
-            if (screenings[i].getId() == id) return const_cast<Screening*>(&screenings[i]);
+        int firstId = nextBookingId.fetch_add((int)requests.size());
+        ReadLock userLock(userMutex);
+        WriteLock bookingLock(bookingMutex);
+        bookingIndex.reserve((uint32_t)(bookings.size() + requests.size()));
+        vector<Handle<Booking>> result;
+        result.reserve(requests.size());
+        for (size_t i = 0; i < requests.size(); i++) {
+            const BookingRequest& r = requests[i];
+            result.push_back(insertBookingLocked(firstId + (int)i, user, r.screening, r.seats, r.count));
         }
-        return nullptr;
-    }
-
-    void addUser(RegularUser* user) {
-        if (userCount >= MAX_USERS) throw InputException("User limit reached.");
-        users[userCount++] = user;
-        saveUsersToFile(); 
+        if (string* rec = call.record()) {
+            putVarint(*rec, (uint64_t)firstId);
+            rec->append(call.args());
+        }
+        call.succeeded();
+        return result;
     }
 
-    RegularUser* findUserByUsername(const char* username) const {
-        for (int i = 0; i < userCount; i++) {
-            if (strcmp(users[i]->getUsername(), username) == 0) return users[i];
+    // Either the booking moves to the new seats or it keeps its old ones. Within the
+    // same screening the seats it already holds may be kept.
+    void changeBooking(int bookingId, Handle<Screening> newScreening, const int newSeats[], int newCount) {
+        TraceCall call(changeLog, TRACE_CHANGE);
+        if (call) {
+            putVarint(call.args(), (uint64_t)bookingId);
+            putVarint(call.args(), (uint64_t)screeningIdOf(newScreening));
+            putSeats(call.args(), newSeats, newCount);
+        }
+        ReadLock catalogLock(catalogMutex);
+        ReadLock userLock(userMutex);
+        WriteLock bookingLock(bookingMutex);
+        Handle<Booking> h = findBookingHandleLocked(bookingId);
+        Booking* booking = bookings.get(h);
+        if (!booking) throw InputException("Booking not found.");
+        Screening* ns = screenings.get(newScreening);
+        bool moved = booking->getScreening() != newScreening;
+        bool ok = newCount > 0 && newCount <= MAX_TICKETS_PER_BOOKING && ns &&
+                  (moved ? ns->bookSeats(newSeats, newCount)
+                         : ns->swapSeats(booking->getSeats(), booking->getSeatCount(), newSeats, newCount));
+        if (!ok) throw InputException("Failed to book requested seats for modified booking.");
+        if (moved) {
+            Screening* old = screenings.get(booking->getScreening());
+            if (old) old->cancelSeats(booking->getSeats(), booking->getSeatCount());
         }
-        return nullptr;
+        recordSale(booking->getScreening(), -booking->getSeatCount());
+        recordSale(newScreening, newCount);
+        if (moved) unlinkBooking(h, BY_SCREENING);
+        booking->changeBooking(newScreening, newSeats, newCount);
+        if (moved) linkBooking(h, BY_SCREENING);
+        call.succeeded();
     }
 
-    void addBooking(RegularUser* user, Screening* screening, const int seats[], int count) {
-        if (bookingCount >= MAX_BOOKINGS) throw InputException("Booking limit reached.");
-        if (!screening->bookSeats(seats, count)) throw InputException("Some seats are already booked or invalid.");
-        int newId = bookingCount + 1;
-        bookings[bookingCount++] = Booking(newId, user, screening, seats, count);
+    Handle<Booking> findBookingHandleById(int id) const {
+        ReadLock lock(bookingMutex);
+        return findBookingHandleLocked(id);
     }
 
-    Booking* findBookingById(int id) {
-        for (int i = 0; i < bookingCount; i++) {
-            if (bookings[i].getId() == id) return &bookings[i];
-        }
-        return nullptr;
+    Booking* findBookingById(int id) const {
+        ReadLock lock(bookingMutex);
+        return bookings.get(findBookingHandleLocked(id));
     }
 
-    int findBookingIndexById(int id) {
-        for (int i = 0; i < bookingCount; i++) {
-            if (bookings[i].getId() == id) return i;
+    void cancelBooking(Handle<Booking> h) {
+        TraceCall call(changeLog, TRACE_CANCEL);
+        if (call) {
+            Booking* b = getBooking(h);
+            putVarint(call.args(), b ? (uint64_t)b->getId() : 0);
         }
-        return -1;
+        ReadLock catalogLock(catalogMutex);
+        ReadLock userLock(userMutex);
+        WriteLock bookingLock(bookingMutex);
+        cancelBookingLocked(h);
+        call.succeeded();
     }
 
-    void cancelBookingByIndex(int index) {
-        bookings[index].getScreening()->cancelSeats(bookings[index].getSeats(), bookings[index].getSeatCount());
-        for (int i = index; i < bookingCount - 1; i++) {
-            bookings[i] = bookings[i + 1];
-        }
-        bookingCount--;
+    // Page `page` of the bookings matching filter, appended to out; true if a later
+    // page exists. Filtered listings walk the matching screenings' booking lists, so
+    // they cost O(matching screenings + rows up to the page), not O(all bookings).
+    bool listBookings(const ListingFilter& filter, size_t page, size_t pageSize, string& out) const {
+        ReadLock catalogLock(catalogMutex);
+        ReadLock userLock(userMutex);
+        ReadLock bookingLock(bookingMutex);
+        return listBookingsLocked(filter, Pager(page, pageSize), out, false);
     }
 
     void displayAllBookings() const {
-        if (bookingCount == 0) {
-            cout << "No bookings available.\n";
-            return;
-        }
-        cout << "+----+------------+----------------------+---------------+---------+-------+\n";
-        cout << "| ID | Username   | Movie                | Date & Time   | Seats   | Count |\n";
-        cout << "+----+------------+----------------------+---------------+---------+-------+\n";
-        for (int i = 0; i < bookingCount; i++) {
-            const Booking& b = bookings[i];
-            cout << "|" << setw(3) << b.getId() << " ";
-            cout << "| " << setw(10) << left << b.getUser()->getUsername();
-            cout << "| " << setw(20) << b.getScreening()->getMovie()->getName();
-            cout << "| " << setw(14) << b.getScreening()->getDateTime();
-            cout << "| ";
-            const int* seatnums = b.getSeats();
-            for (int s = 0; s < b.getSeatCount(); s++) {
-                cout << seatnums[s];
-                if (s < b.getSeatCount() - 1) cout << ",";
-            }
-            cout << setw(7 - b.getSeatCount()) << " ";
-            cout << "| " << setw(5) << b.getSeatCount() << " |\n";
-        }
-        cout << "+----+------------+----------------------+---------------+---------+-------+\n";
+        static thread_local string out;
+        ReadLock catalogLock(catalogMutex);
+        ReadLock userLock(userMutex);
+        ReadLock bookingLock(bookingMutex);
+        listBookingsLocked(ListingFilter(), Pager(0, SIZE_MAX), out, true);
+        writeListing(out);
     }
 
+    // Both reports read the running per-movie totals: O(movies).
     void generateMovieReport() const {
+        ReadLock lock(catalogMutex);
         cout << "--- Movie Booking Report ---\n";
-        for (int i = 0; i < movieCount; i++) {
-            int totalBooked = 0;
-            for (int j = 0; j < bookingCount; j++) {
-                if (bookings[j].getScreening()->getMovie()->getId() == movies[i].getId()) {
-                    totalBooked += bookings[j].getSeatCount();
-                }
-            }
-            cout << "Movie: " << movies[i].getName() << " - Booked Seats: " << totalBooked << "\n";
-        }
+        movies.forEach([&](Handle<Movie>, const Movie& m) {
+            cout << "Movie: " << m.getName() << " - Booked Seats: " << m.getBookedSeats() << "\n";
+        });
     }
 
     void generateRevenueReport() const {
+        ReadLock lock(catalogMutex);
         cout << "--- Revenue Report ---\n";
-        double totalRevenue = 0.0;
-        for (int i = 0; i < movieCount; i++) {
-            double movieRevenue = 0.0;
-            for (int j = 0; j < bookingCount; j++) {
-                if (bookings[j].getScreening()->getMovie()->getId() == movies[i].getId()) {
-                    movieRevenue += bookings[j].getSeatCount() * movies[i].getCost();
-                }
-            }
-            cout << "Movie: " << movies[i].getName() << " - Revenue: $" << fixed << setprecision(2) << movieRevenue << "\n";
-            totalRevenue += movieRevenue;
-        }
-        cout << "Total Revenue: $" << fixed << setprecision(2) << totalRevenue << "\n";
+        long long totalCents = 0;
+        movies.forEach([&](Handle<Movie>, const Movie& m) {
+            cout << "Movie: " << m.getName() << " - Revenue: $" << fixed << setprecision(2) << m.getRevenueCents() / 100.0 << "\n";
+            totalCents += m.getRevenueCents();
+        });
+        cout << "Total Revenue: $" << fixed << setprecision(2) << totalCents / 100.0 << "\n";
     }
 
     IBookingModificationStrategy* getBookingModificationStrategy() {
         return bookingModificationStrategy;
     }
 
-    Booking* getBookings() { return bookings; }
-    int getBookingCount() const { return bookingCount; }
+    // f(handle, booking, screening, movie) runs under the read locks and must not call
+    // back into the system.
+    template <typename F>
+    void forEachBooking(F f) const {
+        ReadLock catalogLock(catalogMutex);
+        ReadLock bookingLock(bookingMutex);
+        bookings.forEach([&](Handle<Booking> h, const Booking& b) {
+            const Screening& s = screenings.at(b.getScreening());
+            f(h, b, s, movies.at(s.getMovie()));
+        });
+    }
+    int getBookingCount() const { ReadLock lock(bookingMutex); return (int)bookings.size(); }
+    int getMovieCount() const { ReadLock lock(catalogMutex); return (int)movies.size(); }
+    int getScreeningCount() const { ReadLock lock(catalogMutex); return (int)screenings.size(); }
+    int getUserCount() const { ReadLock lock(userMutex); return (int)users.size(); }
 };
 
 
@@ -655,7 +2962,8 @@ void BookingModificationStrategy::modifyBooking(Booking* booking) {
     }
     int screeningId = stoi(input);
 
-    Screening* newScreening = system->findScreeningById(screeningId);
+    Handle<Screening> newHandle = system->findScreeningHandleById(screeningId);
+    Screening* newScreening = system->getScreening(newHandle);
     if (!newScreening) {
         cout << "Screening not found, returning to dashboard.\n";
         return;
@@ -668,12 +2976,12 @@ void BookingModificationStrategy::modifyBooking(Booking* booking) {
         getline(cin, input);
     }
     int seatCount = stoi(input);
-    if (seatCount <= 0 || seatCount > newScreening->getSeatCapacity()) {
+    if (seatCount <= 0 || seatCount > newScreening->getSeatCapacity() || seatCount > MAX_TICKETS_PER_BOOKING) {
         cout << "Invalid number of seats.\n";
         return;
     }
 
-    int seatNums[MAX_SEATS];
+    int seatNums[MAX_TICKETS_PER_BOOKING];
     for (int i = 0; i < seatCount; i++) {
         cout << "Enter seat number " << (i + 1) << ": ";
         getline(cin, input);
@@ -683,7 +2991,8 @@ void BookingModificationStrategy::modifyBooking(Booking* booking) {
             continue;
         }
         int seatNum = stoi(input);
-        if (!newScreening->isSeatAvailable(seatNum)) {
+        bool keeping = booking->getScreening() == newHandle && booking->hasSeat(seatNum);
+        if (!keeping && !newScreening->isSeatAvailable(seatNum)) {
             cout << "Seat not available or invalid. Try again.\n";
             i--;
             continue;
@@ -692,7 +3001,7 @@ void BookingModificationStrategy::modifyBooking(Booking* booking) {
     }
 
     try {
-        booking->changeBooking(newScreening, seatNums, seatCount);
+        system->changeBooking(booking->getId(), newHandle, seatNums, seatCount);
         cout << "Booking modified successfully.\n";
     } catch (InputException& e) {
         cout << "Error: " << e.what() << "\n";
@@ -700,9 +3009,12 @@ void BookingModificationStrategy::modifyBooking(Booking* booking) {
 }
 
 // Implement RegularUser methods
-RegularUser::RegularUser() { system = CinemaBookingSystem::getInstance(); }
+RegularUser::RegularUser() : id(0), firstBooking(NO_SLOT) { system = CinemaBookingSystem::getInstance(); }
+
+RegularUser::RegularUser(CinemaBookingSystem* sys, int id_) : system(sys), id(id_), firstBooking(NO_SLOT) {}
 
-RegularUser::RegularUser(const RegularUser& other) : User(other) {
+RegularUser::RegularUser(const RegularUser& other)
+    : User(other), id(other.id), firstBooking(other.firstBooking) {
     strncpy(username, other.username, 19); username[19] = '\0';
     strncpy(password, other.password, 19); password[19] = '\0';
     system = CinemaBookingSystem::getInstance();
@@ -711,6 +3023,8 @@ RegularUser::RegularUser(const RegularUser& other) : User(other) {
 RegularUser& RegularUser::operator=(const RegularUser& other) {
     if (this != &other) {
         User::operator=(other);
+        id = other.id;
+        firstBooking = other.firstBooking;
         system = CinemaBookingSystem::getInstance();
     }
     return *this;
@@ -751,8 +3065,7 @@ void RegularUser::signup() {
     setUsername(user.c_str());
     setPassword(pass.c_str());
     try {
-        RegularUser* newUser = new RegularUser(*this);
-        system->addUser(newUser);
+        system->addUser(username, password);
         cout << "Successfully signed up!\n";
     } catch (InputException& e) {
         cout << "Error: " << e.what() << "\n";
@@ -814,7 +3127,8 @@ void RegularUser::bookTicket() {
         return;
     }
     int screeningId = stoi(input);
-    Screening* screening = system->findScreeningById(screeningId);
+    Handle<Screening> screeningHandle = system->findScreeningHandleById(screeningId);
+    Screening* screening = system->getScreening(screeningHandle);
     if (!screening) {
         cout << "Screening not found.\n";
         return;
@@ -827,12 +3141,30 @@ void RegularUser::bookTicket() {
         return;
     }
     int ticketCount = stoi(input);
-    if (ticketCount <= 0 || ticketCount > screening->getSeatCapacity()) {
+    if (ticketCount <= 0 || ticketCount > screening->getSeatCapacity() || ticketCount > MAX_TICKETS_PER_BOOKING) {
         cout << "Invalid number of tickets.\n";
         return;
     }
 
-    int seats[MAX_SEATS];
+    cout << "Auto-assign the best seats together? (Y/N): ";
+    getline(cin, input);
+    if (!input.empty() && toupper(input[0]) == 'Y') {
+        try {
+            Handle<Booking> h = system->addBestAvailableBooking(system->findUserHandleById(id), screeningHandle, ticketCount);
+            const Booking* b = system->getBooking(h);
+            cout << "Your seats: ";
+            for (int i = 0; i < b->getSeatCount(); i++) {
+                cout << b->getSeats()[i];
+                if (i < b->getSeatCount() - 1) cout << ", ";
+            }
+            cout << "\nBooking finished.\n";
+        } catch (InputException& e) {
+            cout << "Booking error: " << e.what() << "\n";
+        }
+        return;
+    }
+
+    int seats[MAX_TICKETS_PER_BOOKING];
 for (int i = 0; i < ticketCount; i++) {
     cout << "Enter seat number " << (i + 1) << ": ";
     getline(cin, input);
@@ -869,7 +3201,7 @@ for (int i = 0; i < ticketCount; i++) {
 
 
     try {
-        system->addBooking(this, screening, seats, ticketCount);
+        system->addBooking(system->findUserHandleById(id), screeningHandle, seats, ticketCount);
         cout << "Booking finished.\n";
     } catch (InputException& e) {
         cout << "Booking error: " << e.what() << "\n";
@@ -878,14 +3210,11 @@ for (int i = 0; i < ticketCount; i++) {
 
 void RegularUser::modifyBooking() {
     cout << "Your bookings:\n";
-    Booking* allBookings = system->getBookings();
     bool haveBookings = false;
-    for (int i = 0; i < system->getBookingCount(); i++) {
-        if (allBookings[i].getUser() == this) {
-            allBookings[i].display();
-            haveBookings = true;
-        }
-    }
+    system->forEachBookingOfUser(id, [&](Handle<Booking>, const Booking& b, const Screening& s, const Movie& m) {
+        b.display(s, m);
+        haveBookings = true;
+    });
     if (!haveBookings) {
         cout << "No bookings to modify.\n";
         return;
@@ -900,7 +3229,7 @@ void RegularUser::modifyBooking() {
     }
     int bookingId = stoi(input);
     Booking* booking = system->findBookingById(bookingId);
-    if (!booking || booking->getUser() != this) {
+    if (!booking || !owns(booking)) {
         cout << "Booking not found.\n";
         return;
     }
@@ -909,14 +3238,11 @@ void RegularUser::modifyBooking() {
 
 void RegularUser::cancelBooking() {
     cout << "Your bookings:\n";
-    Booking* allBookings = system->getBookings();
     bool haveBookings = false;
-    for (int i = 0; i < system->getBookingCount(); i++) {
-        if (allBookings[i].getUser() == this) {
-            allBookings[i].display();
-            haveBookings = true;
-        }
-    }
+    system->forEachBookingOfUser(id, [&](Handle<Booking>, const Booking& b, const Screening& s, const Movie& m) {
+        b.display(s, m);
+        haveBookings = true;
+    });
     if (!haveBookings) {
         cout << "No bookings to cancel.\n";
         return;
@@ -930,8 +3256,9 @@ void RegularUser::cancelBooking() {
         return;
     }
     int bookingId = stoi(input);
-    int index = system->findBookingIndexById(bookingId);
-    if (index == -1 || system->getBookings()[index].getUser() != this) {
+    Handle<Booking> bookingHandle = system->findBookingHandleById(bookingId);
+    Booking* booking = system->getBooking(bookingHandle);
+    if (!booking || !owns(booking)) {
         cout << "Booking not found.\n";
         return;
     }
@@ -940,38 +3267,39 @@ void RegularUser::cancelBooking() {
     cin >> confirm;
     clearInput();
     if (toupper(confirm) == 'Y') {
-        system->cancelBookingByIndex(index);
+        system->cancelBooking(bookingHandle);
         cout << "Booking cancelled.\n";
     } else {
         cout << "Cancellation aborted.\n";
     }
 }
 
+bool RegularUser::owns(const Booking* booking) const {
+    RegularUser* owner = system->getUser(booking->getUser());
+    return owner && owner->getId() == id;
+}
+
 void RegularUser::viewMyBookings() {
-    Booking* allBookings = system->getBookings();
     bool haveBookings = false;
 
     cout << "+------------+----------------------+---------------+---------+-------+\n";
     cout << "| Movie      | Date & Time          | Hall     | Seats     | Count |\n";
     cout << "+------------+----------------------+----------+-----------+-------+\n";
 
-    for (int i = 0; i < system->getBookingCount(); i++) {
-        if (allBookings[i].getUser() == this) {
-            Screening* s = allBookings[i].getScreening();
-            const int* seats = allBookings[i].getSeats();
-            cout << "| " << setw(10) << left << s->getMovie()->getName()
-                 << "| " << setw(20) << left << s->getDateTime()
-                 << "| " << setw(8) << left << s->getCinemaHall()
-                 << "| ";
-            for (int j = 0; j < allBookings[i].getSeatCount(); j++) {
-                cout << seats[j];
-                if (j < allBookings[i].getSeatCount() - 1) cout << ",";
-            }
-            cout << setw(11 - allBookings[i].getSeatCount() * 2) << " ";
-            cout << "| " << setw(5) << allBookings[i].getSeatCount() << " |\n";
-            haveBookings = true;
+    system->forEachBookingOfUser(id, [&](Handle<Booking>, const Booking& b, const Screening& s, const Movie& m) {
+        const int* seats = b.getSeats();
+        cout << "| " << setw(10) << left << m.getName()
+             << "| " << setw(20) << left << s.getDateTime()
+             << "| " << setw(8) << left << s.getCinemaHall()
+             << "| ";
+        for (int j = 0; j < b.getSeatCount(); j++) {
+            cout << seats[j];
+            if (j < b.getSeatCount() - 1) cout << ",";
         }
-    }
+        cout << setw(11 - b.getSeatCount() * 2) << " ";
+        cout << "| " << setw(5) << b.getSeatCount() << " |\n";
+        haveBookings = true;
+    });
 
     cout << "+------------+----------------------+----------+-----------+-------+\n";
     if (!haveBookings) {
@@ -1002,6 +3330,8 @@ private:
     void addScreening();
     void editScreening();
     void deleteScreening();
+    void viewBookings();
+    void promptHallLayout(const char* hall);
 };
 
 void Admin::login() {
@@ -1054,7 +3384,7 @@ void Admin::displayDashboard() {
             case 4: addScreening(); break;
             case 5: editScreening(); break;
             case 6: deleteScreening(); break;
-            case 7: system->displayAllBookings(); break;
+            case 7: viewBookings(); break;
             case 8: system->generateMovieReport(); break;
             case 9: system->generateRevenueReport(); break;
             case 10: 
@@ -1066,6 +3396,59 @@ void Admin::displayDashboard() {
     }
 }
 
+// Bookings a page at a time, optionally only those for one movie, day or hall.
+void Admin::viewBookings() {
+    const size_t PAGE_SIZE = 20;
+    ListingFilter filter;
+    string input;
+    cout << "Filter bookings by:\n";
+    cout << "1. None\n";
+    cout << "2. Movie\n";
+    cout << "3. Date\n";
+    cout << "4. Hall\n";
+    cout << "Enter choice: ";
+    getline(cin, input);
+    if (input == "2") {
+        cout << "Enter movie ID: ";
+        getline(cin, input);
+        while (!isNumber(input)) {
+            cout << "Invalid input. Enter numeric movie ID: ";
+            getline(cin, input);
+        }
+        filter.movieId = stoi(input);
+    } else if (input == "3") {
+        int year, month, day;
+        cout << "Enter date (YYYY-MM-DD): ";
+        getline(cin, input);
+        while (!parseDate(input.c_str(), year, month, day)) {
+            cout << "Invalid date. Please enter date as YYYY-MM-DD: ";
+            getline(cin, input);
+        }
+        filter.from = makeTime(year, month, day, 0, 0);
+        filter.to = filter.from + SECONDS_PER_DAY;
+    } else if (input == "4") {
+        cout << "Enter cinema hall: ";
+        getline(cin, input);
+        strncpy(filter.hall, input.c_str(), 9);
+        filter.hall[9] = '\0';
+    }
+
+    string page;
+    size_t pageNumber = 0;
+    for (;;) {
+        bool more = system->listBookings(filter, pageNumber, PAGE_SIZE, page);
+        writeListing(page);
+        if (pageNumber == 0 && !more) return;
+        cout << "Page " << pageNumber + 1 << ". " << (more ? "[n]ext, " : "")
+             << (pageNumber > 0 ? "[p]revious, " : "") << "[q]uit: ";
+        getline(cin, input);
+        if (input == "n" && more) pageNumber++;
+        else if (input == "p" && pageNumber > 0) pageNumber--;
+        else if (input == "q" || input.empty() || !cin) return;
+        else cout << "Invalid choice.\n";
+    }
+}
+
 void Admin::addMovie() {
     char name[50], genre[20];
     int duration;
@@ -1213,8 +3596,9 @@ char hall[10];
 char datetime[50];
 cout << "Enter screening date (YYYY-MM-DD): ";
 getline(cin, input);
-while (!regex_match(input, regex("^\\d{4}-\\d{2}-\\d{2}$"))) {
-    cout << "Invalid format. Please enter date as YYYY-MM-DD: ";
+int year, month, day;
+while (!parseDate(input.c_str(), year, month, day)) {
+    cout << "Invalid date. Please enter date as YYYY-MM-DD: ";
     getline(cin, input);
 }
 string date = input;
@@ -1246,12 +3630,14 @@ if (!movie) {
     cout << "Movie not found.\n";
     return;
 }
-string fullDateTime = buildScreeningDateTime(date, hour, minute, movie->getDuration());
-strncpy(datetime, fullDateTime.c_str(), sizeof(datetime)-1);
-datetime[sizeof(datetime)-1] = '\0';
+if (!buildScreeningDateTime(date.c_str(), hour, minute, movie->getDuration(), datetime)) {
+    cout << "Invalid date.\n";
+    return;
+}
 
 cout << "Enter cinema hall: ";
 cin.getline(hall, 10);
+promptHallLayout(hall);
 
 try {
     system->addScreening(movieId, datetime, hall);
@@ -1289,8 +3675,9 @@ void Admin::editScreening() {
 char datetime[50];
 cout << "Enter screening date (YYYY-MM-DD): ";
 getline(cin, input);
-while (!regex_match(input, regex("^\\d{4}-\\d{2}-\\d{2}$"))) {
-    cout << "Invalid format. Please enter date as YYYY-MM-DD: ";
+int year, month, day;
+while (!parseDate(input.c_str(), year, month, day)) {
+    cout << "Invalid date. Please enter date as YYYY-MM-DD: ";
     getline(cin, input);
 }
 string date = input;
@@ -1322,22 +3709,49 @@ if (!movie) {
     cout << "Movie not found.\n";
     return;
 }
-string fullDateTime = buildScreeningDateTime(date, hour, minute, movie->getDuration());
-strncpy(datetime, fullDateTime.c_str(), sizeof(datetime)-1);
-datetime[sizeof(datetime)-1] = '\0';
+if (!buildScreeningDateTime(date.c_str(), hour, minute, movie->getDuration(), datetime)) {
+    cout << "Invalid date.\n";
+    return;
+}
 
 cout << "Enter cinema hall: ";
 cin.getline(hall, 10);
+promptHallLayout(hall);
 
 try {
-    system->addScreening(movieId, datetime, hall);
-    cout << "Screening added.\n";
+    system->editScreening(screeningId, movieId, datetime, hall);
+    cout << "Screening updated.\n";
 } catch (InputException& e) {
     cout << "Error: " << e.what() << "\n";
 }
 
 }
 
+// Asks for the seating plan the first time a hall name is used.
+void Admin::promptHallLayout(const char* hall) {
+    if (system->findHall(hall)) return;
+    string input;
+    cout << "New hall. Enter number of rows: ";
+    getline(cin, input);
+    while (!isNumber(input) || stoi(input) < 1) {
+        cout << "Invalid input. Enter number of rows: ";
+        getline(cin, input);
+    }
+    int rows = stoi(input);
+    cout << "Enter seats per row (max " << MAX_SEATS_PER_ROW << "): ";
+    getline(cin, input);
+    while (!isNumber(input) || stoi(input) < 1 || stoi(input) > MAX_SEATS_PER_ROW) {
+        cout << "Invalid input. Enter seats per row: ";
+        getline(cin, input);
+    }
+    try {
+        system->registerHall(hall, rows, stoi(input));
+    } catch (InputException& e) {
+        cout << "Error: " << e.what() << " Using the default " << DEFAULT_HALL_ROWS << "x"
+             << DEFAULT_SEATS_PER_ROW << " layout.\n";
+    }
+}
+
 void Admin::deleteScreening() {
     system->displayScreenings();
     cout << "Enter screening ID to delete: ";
@@ -1372,8 +3786,885 @@ void Admin::logout() {
  
 
 
-int main() {
-    CinemaBookingSystem* system = CinemaBookingSystem::getInstance();
+// xorshift64* generator for benchmark key streams
+// Headless command language used by --batch. One command per line; fields are
+// separated by blanks and a field containing blanks goes in double quotes. Every
+// command answers with one line, "OK [values]" or "ERR <message>" (report prints its
+// rows first). Blank lines and lines starting with '#' are skipped.
+//
+//   hall NAME ROWS SEATS_PER_ROW
+//   movie NAME GENRE DURATION COST                 -> OK movieId
+//   editmovie ID NAME GENRE DURATION COST
+//   delmovie ID
+//   screening MOVIE_ID YYYY-MM-DD HH:MM HALL       -> OK screeningId
+//   delscreening ID
+//   user USERNAME PASSWORD                         -> OK userId
+//   book USERNAME SCREENING_ID SEAT[,SEAT...]      -> OK bookingId
+//   best USERNAME SCREENING_ID COUNT               -> OK bookingId seat,seat,...
+//   group USERNAME SCREENING_ID:SEAT[,SEAT...] ... -> OK firstBookingId bookings
+//   change BOOKING_ID SCREENING_ID SEAT[,SEAT...]
+//   cancel BOOKING_ID
+//   report                                         -> "M movieId bookedSeats revenueCents" rows, OK movies
+//   stats                                          -> OK movies screenings bookings users
+class CommandInterpreter {
+private:
+    static const int MAX_FIELDS = 64;
+    CinemaBookingSystem* system;
+    char* field[MAX_FIELDS];
+    int fieldCount;
+    long long commands;
+    long long errors;
+
+    // Splits the line in place; false on too many fields or an unclosed quote.
+    bool split(char* line) {
+        fieldCount = 0;
+        char* p = line;
+        for (;;) {
+            while (*p == ' ' || *p == '\t') p++;
+            if (!*p) return true;
+            if (fieldCount == MAX_FIELDS) return false;
+            if (*p == '"') {
+                field[fieldCount++] = ++p;
+                while (*p && *p != '"') p++;
+                if (!*p) return false;
+            } else {
+                field[fieldCount++] = p;
+                while (*p && *p != ' ' && *p != '\t') p++;
+                if (!*p) return true;
+            }
+            *p++ = '\0';
+        }
+    }
+
+    static bool parseInt(const char* s, int& out) {
+        if (!*s) return false;
+        long long v = 0;
+        for (; *s; s++) {
+            if (*s < '0' || *s > '9' || v > 100000000) return false;
+            v = v * 10 + (*s - '0');
+        }
+        out = (int)v;
+        return true;
+    }
+
+    // Comma-separated seat numbers, at most one booking's worth.
+    static bool parseSeats(const char* s, int seats[], int& count) {
+        count = 0;
+        int v = 0;
+        bool digit = false;
+        for (;; s++) {
+            if (*s >= '0' && *s <= '9') {
+                if (v > 100000) return false;
+                v = v * 10 + (*s - '0');
+                digit = true;
+            } else if ((*s == ',' || !*s) && digit) {
+                if (count == MAX_TICKETS_PER_BOOKING) return false;
+                seats[count++] = v;
+                v = 0;
+                digit = false;
+                if (!*s) return true;
+            } else {
+                return false;
+            }
+        }
+    }
+
+    // "HH:MM"
+    static bool parseTime(const char* s, int& hour, int& minute) {
+        if (strlen(s) != 5 || s[2] != ':') return false;
+        for (int i : {0, 1, 3, 4}) {
+            if (!isdigit((unsigned char)s[i])) return false;
+        }
+        hour = (s[0] - '0') * 10 + (s[1] - '0');
+        minute = (s[3] - '0') * 10 + (s[4] - '0');
+        return hour < 24 && minute < 60;
+    }
+
+    static bool isDate(const char* s) {
+        int year, month, day;
+        return parseDate(s, year, month, day);
+    }
+
+    // "YYYY-MM-DD" "HH:MM" as a screening time.
+    static bool parseWhen(const char* date, const char* time, long long& out) {
+        int year, month, day, hour, minute;
+        if (!parseDate(date, year, month, day) || !parseTime(time, hour, minute)) return false;
+        out = makeTime(year, month, day, hour, minute);
+        return true;
+    }
+
+    void fail(string& out, const char* msg) {
+        errors++;
+        out += "ERR ";
+        out += msg;
+        out += '\n';
+    }
+
+    void ok(string& out) { out += "OK\n"; }
+
+    void ok(string& out, long long value) {
+        out += "OK ";
+        out += to_string(value);
+        out += '\n';
+    }
+
+    Handle<RegularUser> userNamed(const char* name) {
+        Handle<RegularUser> h = system->findUserHandleByUsername(name);
+        if (h.isNull()) throw InputException("Unknown user.");
+        return h;
+    }
+
+    void book(string& out) {
+        int screeningId, seats[MAX_TICKETS_PER_BOOKING], count;
+        if (fieldCount != 4 || !parseInt(field[2], screeningId) || !parseSeats(field[3], seats, count)) {
+            return fail(out, "Usage: book USERNAME SCREENING_ID SEAT[,SEAT...]");
+        }
+        Handle<Booking> h = system->addBooking(userNamed(field[1]), system->findScreeningHandleById(screeningId), seats, count);
+        ok(out, system->getBooking(h)->getId());
+    }
+
+    void bookBest(string& out) {
+        int screeningId, count;
+        if (fieldCount != 4 || !parseInt(field[2], screeningId) || !parseInt(field[3], count)) {
+            return fail(out, "Usage: best USERNAME SCREENING_ID COUNT");
+        }
+        Handle<Booking> h = system->addBestAvailableBooking(userNamed(field[1]), system->findScreeningHandleById(screeningId), count);
+        const Booking* b = system->getBooking(h);
+        out += "OK ";
+        out += to_string(b->getId());
+        out += ' ';
+        for (int i = 0; i < b->getSeatCount(); i++) {
+            if (i) out += ',';
+            out += to_string(b->getSeats()[i]);
+        }
+        out += '\n';
+    }
+
+    void bookGroup(string& out) {
+        if (fieldCount < 3) return fail(out, "Usage: group USERNAME SCREENING_ID:SEAT[,SEAT...] ...");
+        vector<BookingRequest> order(fieldCount - 2);
+        for (int i = 2; i < fieldCount; i++) {
+            char* colon = strchr(field[i], ':');
+            int screeningId;
+            BookingRequest& r = order[i - 2];
+            if (!colon) return fail(out, "Usage: group USERNAME SCREENING_ID:SEAT[,SEAT...] ...");
+            *colon = '\0';
+            if (!parseInt(field[i], screeningId) || !parseSeats(colon + 1, r.seats, r.count)) {
+                return fail(out, "Usage: group USERNAME SCREENING_ID:SEAT[,SEAT...] ...");
+            }
+            r.screening = system->findScreeningHandleById(screeningId);
+        }
+        vector<Handle<Booking>> made = system->addBookingBatch(userNamed(field[1]), order);
+        out += "OK ";
+        out += to_string(system->getBooking(made[0])->getId());
+        out += ' ';
+        out += to_string(made.size());
+        out += '\n';
+    }
+
+    void change(string& out) {
+        int bookingId, screeningId, seats[MAX_TICKETS_PER_BOOKING], count;
+        if (fieldCount != 4 || !parseInt(field[1], bookingId) || !parseInt(field[2], screeningId) ||
+            !parseSeats(field[3], seats, count)) {
+            return fail(out, "Usage: change BOOKING_ID SCREENING_ID SEAT[,SEAT...]");
+        }
+        system->changeBooking(bookingId, system->findScreeningHandleById(screeningId), seats, count);
+        ok(out);
+    }
+
+    void cancel(string& out) {
+        int bookingId;
+        if (fieldCount != 2 || !parseInt(field[1], bookingId)) return fail(out, "Usage: cancel BOOKING_ID");
+        Handle<Booking> h = system->findBookingHandleById(bookingId);
+        if (h.isNull()) return fail(out, "Booking not found.");
+        system->cancelBooking(h);
+        ok(out);
+    }
+
+    void addUser(string& out) {
+        if (fieldCount != 3) return fail(out, "Usage: user USERNAME PASSWORD");
+        if (strlen(field[1]) > 19 || strlen(field[2]) > 19 || strpbrk(field[1], " \t") || strpbrk(field[2], " \t")) {
+            return fail(out, "Username and password must be 1-19 characters without spaces.");
+        }
+        if (!system->findUserHandleByUsername(field[1]).isNull()) return fail(out, "Username already taken.");
+        ok(out, system->getUser(system->addUser(field[1], field[2]))->getId());
+    }
+
+    void addHall(string& out) {
+        int rows, seatsPerRow;
+        if (fieldCount != 4 || !parseInt(field[2], rows) || !parseInt(field[3], seatsPerRow)) {
+            return fail(out, "Usage: hall NAME ROWS SEATS_PER_ROW");
+        }
+        if (strlen(field[1]) > 9) return fail(out, "Hall name must be at most 9 characters.");
+        system->registerHall(field[1], rows, seatsPerRow);
+        ok(out);
+    }
+
+    // Shared by movie and editmovie: fields from `first` are NAME GENRE DURATION COST.
+    bool parseMovie(int first, int& duration, double& cost) {
+        char* end;
+        cost = strtod(field[first + 3], &end);
+        return parseInt(field[first + 2], duration) && *end == '\0' && end != field[first + 3] && cost >= 0;
+    }
+
+    void addMovie(string& out) {
+        int duration;
+        double cost;
+        if (fieldCount != 5 || !parseMovie(1, duration, cost)) return fail(out, "Usage: movie NAME GENRE DURATION COST");
+        ok(out, system->addMovie(field[1], field[2], duration, cost));
+    }
+
+    void editMovie(string& out) {
+        int id, duration;
+        double cost;
+        if (fieldCount != 6 || !parseInt(field[1], id) || !parseMovie(2, duration, cost)) {
+            return fail(out, "Usage: editmovie ID NAME GENRE DURATION COST");
+        }
+        system->editMovie(id, field[2], field[3], duration, cost);
+        ok(out);
+    }
+
+    void addScreening(string& out) {
+        int movieId, hour, minute;
+        if (fieldCount != 5 || !parseInt(field[1], movieId) || !isDate(field[2]) || !parseTime(field[3], hour, minute)) {
+            return fail(out, "Usage: screening MOVIE_ID YYYY-MM-DD HH:MM HALL");
+        }
+        if (strlen(field[4]) > 9) return fail(out, "Hall name must be at most 9 characters.");
+        Movie* movie = system->findMovieById(movieId);
+        if (!movie) return fail(out, "Movie not found.");
+        char datetime[SCREENING_TIME_LEN + 1];
+        buildScreeningDateTime(field[2], hour, minute, movie->getDuration(), datetime);
+        ok(out, system->addScreening(movieId, datetime, field[4]));
+    }
+
+    // One "S ID HALL START END MOVIE_ID" line per screening, then "OK count".
+    void showing(string& out) {
+        long long from, to;
+        if ((fieldCount != 5 && fieldCount != 6) || !parseWhen(field[1], field[2], from) || !parseWhen(field[3], field[4], to)) {
+            return fail(out, "Usage: showing YYYY-MM-DD HH:MM YYYY-MM-DD HH:MM [HALL]");
+        }
+        int rows = 0;
+        system->forEachScreeningBetween(from, to, fieldCount == 6 ? field[5] : nullptr, [&](const Screening& s, const Movie& m) {
+            char start[17], end[6];
+            formatDateTime(s.getStartTime(), start);
+            formatClock(s.getEndTime(), end);
+            out += "S ";
+            out += to_string(s.getId());
+            out += ' ';
+            out += s.getCinemaHall();
+            out += ' ';
+            out += start;
+            out += ' ';
+            out += end;
+            out += ' ';
+            out += to_string(m.getId());
+            out += '\n';
+            rows++;
+        });
+        ok(out, rows);
+    }
+
+    void deleteById(string& out, bool movie) {
+        int id;
+        if (fieldCount != 2 || !parseInt(field[1], id)) return fail(out, movie ? "Usage: delmovie ID" : "Usage: delscreening ID");
+        if (movie) system->deleteMovie(id);
+        else system->deleteScreening(id);
+        ok(out);
+    }
+
+    void report(string& out) {
+        int rows = 0;
+        system->forEachMovie([&](const Movie& m) {
+            out += "M ";
+            out += to_string(m.getId());
+            out += ' ';
+            out += to_string(m.getBookedSeats());
+            out += ' ';
+            out += to_string(m.getRevenueCents());
+            out += '\n';
+            rows++;
+        });
+        ok(out, rows);
+    }
+
+    void stats(string& out) {
+        out += "OK " + to_string(system->getMovieCount()) + " " + to_string(system->getScreeningCount()) + " " +
+               to_string(system->getBookingCount()) + " " + to_string(system->getUserCount()) + "\n";
+    }
+
+public:
+    explicit CommandInterpreter(CinemaBookingSystem* sys) : system(sys), fieldCount(0), commands(0), errors(0) {}
+
+    long long getCommandCount() const { return commands; }
+    long long getErrorCount() const { return errors; }
+
+    // Runs one line (modified in place) and appends its answer to out.
+    void execute(char* line, string& out) {
+        if (!split(line)) return fail(out, "Malformed line.");
+        if (fieldCount == 0 || field[0][0] == '#') return;
+        commands++;
+        const char* cmd = field[0];
+        try {
+            if (strcmp(cmd, "book") == 0) book(out);
+            else if (strcmp(cmd, "best") == 0) bookBest(out);
+            else if (strcmp(cmd, "cancel") == 0) cancel(out);
+            else if (strcmp(cmd, "change") == 0) change(out);
+            else if (strcmp(cmd, "group") == 0) bookGroup(out);
+            else if (strcmp(cmd, "user") == 0) addUser(out);
+            else if (strcmp(cmd, "screening") == 0) addScreening(out);
+            else if (strcmp(cmd, "movie") == 0) addMovie(out);
+            else if (strcmp(cmd, "editmovie") == 0) editMovie(out);
+            else if (strcmp(cmd, "delmovie") == 0) deleteById(out, true);
+            else if (strcmp(cmd, "delscreening") == 0) deleteById(out, false);
+            else if (strcmp(cmd, "hall") == 0) addHall(out);
+            else if (strcmp(cmd, "showing") == 0) showing(out);
+            else if (strcmp(cmd, "report") == 0) report(out);
+            else if (strcmp(cmd, "stats") == 0) stats(out);
+            else fail(out, "Unknown command.");
+        } catch (InputException& e) {
+            fail(out, e.what());
+        }
+    }
+};
+
+// --batch: reads commands from `in` in large blocks and writes the answers in large
+// blocks, so a whole day's sales go through without a prompt or a flush per line.
+void runBatch(CinemaBookingSystem* sys, FILE* in) {
+    const size_t BLOCK = 1 << 16;
+    CommandInterpreter interpreter(sys);
+    vector<char> buf(BLOCK + 1);
+    string out;
+    out.reserve(BLOCK * 2);
+    size_t have = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    sys->setSyncEachCall(false);
+    for (;;) {
+        if (have == buf.size() - 1) buf.resize(buf.size() * 2);   // line longer than the buffer
+        size_t got = fread(buf.data() + have, 1, buf.size() - 1 - have, in);
+        have += got;
+        bool eof = got == 0;
+        size_t lineStart = 0;
+        for (size_t i = 0; i < have; i++) {
+            if (buf[i] != '\n') continue;
+            size_t end = i;
+            if (end > lineStart && buf[end - 1] == '\r') end--;
+            buf[end] = '\0';
+            interpreter.execute(buf.data() + lineStart, out);
+            lineStart = i + 1;
+        }
+        if (eof && lineStart < have) {
+            buf[have] = '\0';
+            interpreter.execute(buf.data() + lineStart, out);
+            lineStart = have;
+        }
+        memmove(buf.data(), buf.data() + lineStart, have - lineStart);
+        have -= lineStart;
+        if (out.size() >= BLOCK || eof) {
+            sys->syncJournal();
+            fwrite(out.data(), 1, out.size(), stdout);
+            out.clear();
+        }
+        if (eof) break;
+    }
+    sys->setSyncEachCall(true);
+    fflush(stdout);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << "batch: " << interpreter.getCommandCount() << " commands, " << interpreter.getErrorCount()
+         << " errors, " << fixed << setprecision(3) << seconds << " s, " << setprecision(0)
+         << (seconds > 0 ? interpreter.getCommandCount() / seconds : 0) << " ops/s\n";
+}
+
+struct BenchRng {
+    uint64_t state;
+    explicit BenchRng(uint64_t seed) : state(seed ? seed : 1) {}
+    uint32_t next() {
+        state ^= state >> 12; state ^= state << 25; state ^= state >> 27;
+        return (uint32_t)((state * 0x2545F4914F6CDD1DULL) >> 32);
+    }
+};
+
+double nsPerOp(chrono::steady_clock::time_point start, long long ops) {
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / (double)ops;
+}
+
+// Every heap allocation in the program goes through here so the benchmarks can
+// report allocations per operation. A relaxed increment costs next to nothing.
+static atomic<long long> allocationCount(0);
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+// Out of line so GCC does not pair the inlined free() with operator new and warn.
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+void operator delete(void* p) noexcept { free(p); }
+
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+struct BenchResult {
+    double ns;
+    double allocs;
+};
+
+template <typename F>
+BenchResult measure(long long ops, F f) {
+    long long allocsBefore = allocationCount.load(memory_order_relaxed);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (long long i = 0; i < ops; i++) f(i);
+    double ns = nsPerOp(start, ops);
+    return {ns, (allocationCount.load(memory_order_relaxed) - allocsBefore) / (double)ops};
+}
+
+// Datetime of the n-th generated screening: back-to-back two-hour shows from
+// 2026-01-01 00:00, so any number of them fit in one hall. buf holds 25 bytes.
+void showTimeForTest(long long n, char* buf) {
+    long long start = makeTime(2026, 1, 1, 0, 0) + n * 7200;
+    formatScreeningTime(start, start + 7200, buf);
+}
+
+void printBench(long long records, const char* operation, BenchResult r) {
+    cout << setw(10) << records << "  " << setw(30) << left << operation << right
+         << fixed << setprecision(1) << setw(10) << r.ns << setprecision(2) << setw(11) << r.allocs << "\n";
+}
+
+// Microbenchmarks for the booking hot paths at 10^2 .. maxRecords bookings. The
+// catalogue grows with the bookings: users = records / 10 and movies = records / 100
+// (at least 10 each), screenings as needed to seat every booking in a 1024-seat hall.
+// Each size reports ns/op and heap allocations per op for:
+//   find*ById / findUserByUsername   random lookups
+//   addBooking / cancelBooking       up to 100k extra bookings added, then cancelled
+//   Screening::bookSeats+cancel      claim and release 4 seats in one seat map
+//   deleteMovie cascade              per refunded booking, for a movie with up to 100k
+//   movie / revenue report           per call (output discarded)
+void runBenchmarks(long long maxRecords) {
+    CinemaBookingSystem* sys = CinemaBookingSystem::createStandalone();
+    sys->registerHall("BIG", 16, 64);
+    const int SEATS = 16 * 64;
+    const int LOOKUPS = 1000000;
+    const int POOL = 1 << 18;
+    static char names[POOL][20];
+    static int movieIds[POOL], screeningIds[POOL], bookingIds[POOL];
+    BenchRng rng(42);
+    long long sink = 0;
+    ostringstream devNull;
+    vector<int> allMovies, allScreenings, allBookings;   // the extra records are deleted, so IDs have gaps
+    vector<Handle<Booking>> extra;
+    long long shows = 0;
+    char when[25];
+
+    cout << setw(10) << "records" << "  " << setw(30) << left << "operation" << right
+         << setw(10) << "ns/op" << setw(11) << "allocs/op" << "\n";
+    for (long long size = 100; size <= maxRecords; size *= 10) {
+        int userCount = (int)max(10LL, size / 10);
+        int movieCount = (int)max(10LL, size / 100);
+        while (sys->getMovieCount() < movieCount) allMovies.push_back(sys->addMovie("Bench Movie", "Drama", 120, 10.0));
+        while (sys->getUserCount() < userCount) {
+            char name[20];
+            snprintf(name, sizeof(name), "u%08d", sys->getUserCount());
+            sys->addUser(name, "pw");
+        }
+        while ((long long)allScreenings.size() * SEATS < size) {
+            showTimeForTest(shows++, when);
+            allScreenings.push_back(sys->addScreening(allMovies[allScreenings.size() % movieCount], when, "BIG"));
+        }
+        Handle<RegularUser> buyer = sys->findUserHandleByUsername("u00000000");
+        while ((long long)allBookings.size() < size) {
+            int n = (int)allBookings.size();
+            int seat = n % SEATS + 1;
+            Handle<Booking> h = sys->addBooking(buyer, sys->findScreeningHandleById(allScreenings[n / SEATS]), &seat, 1);
+            allBookings.push_back(sys->getBooking(h)->getId());
+        }
+        for (int i = 0; i < POOL; i++) {
+            snprintf(names[i], sizeof(names[i]), "u%08d", (int)(rng.next() % userCount));
+            movieIds[i] = allMovies[rng.next() % allMovies.size()];
+            screeningIds[i] = allScreenings[rng.next() % allScreenings.size()];
+            bookingIds[i] = allBookings[rng.next() % allBookings.size()];
+        }
+
+        printBench(size, "findMovieById", measure(LOOKUPS, [&](long long i) {
+            sink += sys->findMovieById(movieIds[i & (POOL - 1)])->getDuration();
+        }));
+        printBench(size, "findScreeningById", measure(LOOKUPS, [&](long long i) {
+            sink += sys->findScreeningById(screeningIds[i & (POOL - 1)])->getSeatCapacity();
+        }));
+        printBench(size, "findBookingById", measure(LOOKUPS, [&](long long i) {
+            sink += sys->findBookingById(bookingIds[i & (POOL - 1)])->getSeatCount();
+        }));
+        printBench(size, "findUserByUsername", measure(LOOKUPS, [&](long long i) {
+            sink += sys->findUserByUsername(names[i & (POOL - 1)]) != nullptr;
+        }));
+
+        // Extra bookings go to a throwaway movie so its deletion can be timed after.
+        int extraCount = (int)min(size, 100000LL);
+        int victim = sys->addMovie("Victim", "Drama", 120, 10.0);
+        vector<Handle<Screening>> spare;
+        for (int i = 0; i * SEATS < extraCount; i++) {
+            showTimeForTest(shows++, when);
+            spare.push_back(sys->findScreeningHandleById(sys->addScreening(victim, when, "BIG")));
+        }
+        extra.clear();
+        extra.reserve(extraCount);
+        printBench(size, "addBooking", measure(extraCount, [&](long long i) {
+            int seat = (int)(i % SEATS) + 1;
+            extra.push_back(sys->addBooking(buyer, spare[i / SEATS], &seat, 1));
+        }));
+        printBench(size, "cancelBooking", measure(extraCount, [&](long long i) {
+            sys->cancelBooking(extra[i]);
+        }));
+
+        Screening* seatMap = sys->getScreening(spare[0]);
+        printBench(size, "Screening::bookSeats+cancel", measure(LOOKUPS, [&](long long i) {
+            int base = (int)(i % (SEATS / 4)) * 4;
+            int seats[4] = {base + 1, base + 2, base + 3, base + 4};
+            sink += seatMap->bookSeats(seats, 4);
+            seatMap->cancelSeats(seats, 4);
+        }));
+
+        for (int i = 0; i < extraCount; i++) {
+            int seat = i % SEATS + 1;
+            sys->addBooking(buyer, spare[i / SEATS], &seat, 1);
+        }
+        BenchResult cascade = measure(1, [&](long long) { sys->deleteMovie(victim); });
+        cascade.ns /= extraCount;
+        cascade.allocs /= extraCount;
+        printBench(size, "deleteMovie cascade (/booking)", cascade);
+
+        int reportRuns = max(1, 1000000 / movieCount);
+        streambuf* console = cout.rdbuf(devNull.rdbuf());
+        BenchResult movieReport = measure(reportRuns, [&](long long) {
+            sys->generateMovieReport();
+            devNull.str("");
+        });
+        BenchResult revenueReport = measure(reportRuns, [&](long long) {
+            sys->generateRevenueReport();
+            devNull.str("");
+        });
+        cout.rdbuf(console);
+        printBench(size, "generateMovieReport", movieReport);
+        printBench(size, "generateRevenueReport", revenueReport);
+    }
+    cout << "(checksum " << sink << ")\n";
+    delete sys;
+}
+
+static const char* const TRACE_OP_NAMES[TRACE_OP_COUNT] = {
+    "?", "hall", "movie", "editmovie", "delmovie", "screening", "editscreening",
+    "delscreening", "user", "book", "best", "group", "change", "cancel"
+};
+
+// Runs one decoded trace record against sys. Throws InputException like the call did.
+void replayRecord(CinemaBookingSystem* sys, int op, TraceReader& in) {
+    char name[64], other[64];
+    int seats[MAX_TICKETS_PER_BOOKING];
+    switch (op) {
+    case TRACE_HALL: {
+        in.text(name, sizeof(name));
+        int rows = in.integer();
+        int seatsPerRow = in.integer();
+        sys->registerHall(name, rows, seatsPerRow);
+        break;
+    }
+    case TRACE_MOVIE:
+    case TRACE_EDIT_MOVIE: {
+        int id = op == TRACE_EDIT_MOVIE ? in.integer() : 0;
+        in.text(name, sizeof(name));
+        in.text(other, sizeof(other));
+        int duration = in.integer();
+        double cost = in.real();
+        if (op == TRACE_MOVIE) sys->addMovie(name, other, duration, cost);
+        else sys->editMovie(id, name, other, duration, cost);
+        break;
+    }
+    case TRACE_DELETE_MOVIE:
+        sys->deleteMovie(in.integer());
+        break;
+    case TRACE_SCREENING:
+    case TRACE_EDIT_SCREENING: {
+        int id = op == TRACE_EDIT_SCREENING ? in.integer() : 0;
+        int movieId = in.integer();
+        in.text(name, sizeof(name));
+        in.text(other, sizeof(other));
+        if (op == TRACE_SCREENING) sys->addScreening(movieId, name, other);
+        else sys->editScreening(id, movieId, name, other);
+        break;
+    }
+    case TRACE_DELETE_SCREENING:
+        sys->deleteScreening(in.integer());
+        break;
+    case TRACE_USER:
+        in.text(name, sizeof(name));
+        sys->addUser(name, "replay");
+        break;
+    case TRACE_BOOK: {
+        Handle<RegularUser> user = sys->findUserHandleById(in.integer());
+        Handle<Screening> screening = sys->findScreeningHandleById(in.integer());
+        int count = in.seats(seats);
+        sys->addBooking(user, screening, seats, count);
+        break;
+    }
+    case TRACE_BEST: {
+        Handle<RegularUser> user = sys->findUserHandleById(in.integer());
+        Handle<Screening> screening = sys->findScreeningHandleById(in.integer());
+        sys->addBestAvailableBooking(user, screening, in.integer());
+        break;
+    }
+    case TRACE_GROUP: {
+        Handle<RegularUser> user = sys->findUserHandleById(in.integer());
+        uint64_t n = in.varint();
+        if (n > (uint64_t)(in.end - in.p)) throw InputException("Corrupt trace record.");
+        vector<BookingRequest> order((size_t)n);
+        for (BookingRequest& r : order) {
+            r.screening = sys->findScreeningHandleById(in.integer());
+            r.count = in.seats(r.seats);
+        }
+        sys->addBookingBatch(user, order);
+        break;
+    }
+    case TRACE_CHANGE: {
+        int bookingId = in.integer();
+        Handle<Screening> screening = sys->findScreeningHandleById(in.integer());
+        int count = in.seats(seats);
+        sys->changeBooking(bookingId, screening, seats, count);
+        break;
+    }
+    case TRACE_CANCEL:
+        sys->cancelBooking(sys->findBookingHandleById(in.integer()));
+        break;
+    }
+}
+
+// --replay: re-runs a trace against a fresh in-memory system as fast as it will go and
+// prints per-operation latency percentiles. A call diverges when it succeeds where
+// the recording failed or the other way round; traces of a single seller replay
+// with none.
+bool runReplay(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        cerr << "Cannot open " << path << "\n";
+        return false;
+    }
+    vector<unsigned char> data;
+    unsigned char block[1 << 16];
+    size_t got;
+    while ((got = fread(block, 1, sizeof(block), f)) > 0) data.insert(data.end(), block, block + got);
+    fclose(f);
+    if (data.size() < sizeof(TRACE_MAGIC) || memcmp(data.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+        cerr << path << " is not a trace file\n";
+        return false;
+    }
+
+    CinemaBookingSystem* sys = CinemaBookingSystem::createStandalone();
+    vector<uint32_t> latency[TRACE_OP_COUNT];
+    long long diverged = 0, ops = 0;
+    double recordedSeconds = 0;
+    TraceReader file(data.data() + sizeof(TRACE_MAGIC), data.data() + data.size());
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    while (file.p < file.end) {
+        int op = file.end - file.p >= 2 ? file.p[0] : 0;
+        bool recordedOk = op && file.p[1];
+        if (op) file.p += 2;
+        recordedSeconds += file.varint() / 1e6;
+        uint64_t len = file.varint();
+        if (!op || !file.ok || len > (uint64_t)(file.end - file.p)) {
+            cerr << "Trace is truncated or corrupt after " << ops << " records\n";
+            break;
+        }
+        TraceReader record(file.p, file.p + len);
+        file.p += len;
+        if (op >= TRACE_OP_COUNT) continue;   // written by a newer build
+
+        bool ok = true;
+        chrono::steady_clock::time_point t = chrono::steady_clock::now();
+        try {
+            replayRecord(sys, op, record);
+        } catch (InputException&) {
+            ok = false;
+        }
+        latency[op].push_back((uint32_t)min<long long>(UINT32_MAX,
+            chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t).count()));
+        if (ok != recordedOk || !record.ok) diverged++;
+        ops++;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << setw(14) << left << "operation" << right << setw(10) << "count" << setw(10) << "p50 ns"
+         << setw(10) << "p99 ns" << setw(11) << "p99.9 ns" << setw(11) << "max ns" << "\n";
+    vector<uint32_t> all;
+    for (int op = 0; op <= TRACE_OP_COUNT; op++) {
+        vector<uint32_t>& v = op < TRACE_OP_COUNT ? latency[op] : all;
+        if (v.empty()) continue;
+        if (op < TRACE_OP_COUNT) all.insert(all.end(), v.begin(), v.end());
+        sort(v.begin(), v.end());
+        cout << setw(14) << left << (op < TRACE_OP_COUNT ? TRACE_OP_NAMES[op] : "all") << right
+             << setw(10) << v.size() << setw(10) << v[v.size() / 2] << setw(10) << v[v.size() * 99 / 100]
+             << setw(11) << v[v.size() * 999 / 1000] << setw(11) << v.back() << "\n";
+    }
+    cout << "replayed " << ops << " calls in " << fixed << setprecision(3) << seconds << " s ("
+         << setprecision(0) << (seconds > 0 ? ops / seconds : 0) << " calls/s; recorded over "
+         << setprecision(3) << recordedSeconds << " s), " << diverged << " diverged\n";
+    delete sys;
+    return diverged == 0;
+}
+
+// Runs sellers on 1, 2, 4, ... maxThreads threads against a fresh system each time.
+// Every seller books random seats (some as "best together" or as group orders),
+// cancels some of its own bookings, and the run is then audited: every sold seat must belong to exactly one
+// booking and the seat maps and movie totals must agree with the booking records.
+bool runStressTest(int maxThreads) {
+    const int MOVIES = 8;
+    const int SCREENINGS = 64;
+    const int OPS_PER_THREAD = 200000;
+    bool allOk = true;
+    double baseRate = 0;
+
+    cout << setw(8) << "threads" << setw(14) << "ops/s" << setw(10) << "speedup"
+         << setw(12) << "sold" << setw(12) << "rejected" << "  audit\n";
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        CinemaBookingSystem* sys = CinemaBookingSystem::createStandalone();
+        sys->registerHall("BIG", 16, 64);
+        for (int m = 0; m < MOVIES; m++) sys->addMovie("Stress Movie", "Drama", 120, 7.5 + m);
+        for (int i = 0; i < SCREENINGS; i++) {
+            char when[25];
+            showTimeForTest(i, when);
+            sys->addScreening(1 + i % MOVIES, when, "BIG");
+        }
+        const int capacity = sys->findScreeningById(1)->getSeatCapacity();
+        vector<Handle<RegularUser>> sellers;
+        for (int t = 0; t < threads; t++) {
+            char name[20];
+            snprintf(name, sizeof(name), "seller%d", t);
+            sellers.push_back(sys->addUser(name, "pw"));
+        }
+
+        atomic<long long> rejected(0);
+        vector<thread> pool;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int t = 0; t < threads; t++) {
+            pool.emplace_back([&, t]() {
+                BenchRng rng(1234567 + t);
+                vector<int> mine;
+                for (int op = 0; op < OPS_PER_THREAD; op++) {
+                    Handle<Screening> sh = sys->findScreeningHandleById(1 + rng.next() % SCREENINGS);
+                    try {
+                        if (!mine.empty() && rng.next() % 3 == 0) {
+                            size_t pick = rng.next() % mine.size();
+                            sys->cancelBooking(sys->findBookingHandleById(mine[pick]));
+                            mine[pick] = mine.back();
+                            mine.pop_back();
+                        } else if (rng.next() % 4 == 0) {
+                            Handle<Booking> h = sys->addBestAvailableBooking(sellers[t], sh, 1 + rng.next() % 6);
+                            mine.push_back(sys->getBooking(h)->getId());
+                        } else if (rng.next() % 8 == 0) {
+                            vector<BookingRequest> order(1 + rng.next() % 4);
+                            for (BookingRequest& r : order) {
+                                r.screening = sys->findScreeningHandleById(1 + rng.next() % SCREENINGS);
+                                r.count = 1 + rng.next() % 4;
+                                for (int i = 0; i < r.count; i++) r.seats[i] = 1 + rng.next() % capacity;
+                            }
+                            for (Handle<Booking> h : sys->addBookingBatch(sellers[t], order)) {
+                                mine.push_back(sys->getBooking(h)->getId());
+                            }
+                        } else {
+                            int seats[4];
+                            int count = 1 + rng.next() % 4;
+                            for (int i = 0; i < count; i++) seats[i] = 1 + rng.next() % capacity;
+                            Handle<Booking> h = sys->addBooking(sellers[t], sh, seats, count);
+                            mine.push_back(sys->getBooking(h)->getId());
+                        }
+                    } catch (InputException&) {
+                        rejected.fetch_add(1, memory_order_relaxed);
+                    }
+                }
+            });
+        }
+        for (thread& th : pool) th.join();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        double rate = (double)threads * OPS_PER_THREAD / seconds;
+        if (threads == 1) baseRate = rate;
+
+        // Audit: rebuild seat ownership from the booking records.
+        vector<vector<int>> owner(SCREENINGS + 1, vector<int>(capacity + 1, 0));
+        vector<long long> movieSeats(MOVIES + 1, 0);
+        long long sold = 0;
+        bool ok = true;
+        sys->forEachBooking([&](Handle<Booking>, const Booking& b, const Screening& s, const Movie& m) {
+            for (int i = 0; i < b.getSeatCount(); i++) {
+                int& o = owner[s.getId()][b.getSeats()[i]];
+                if (o != 0) ok = false;   // seat sold twice
+                o = b.getId();
+            }
+            movieSeats[m.getId()] += b.getSeatCount();
+            sold += b.getSeatCount();
+        });
+        for (int i = 1; i <= SCREENINGS; i++) {
+            Screening* s = sys->findScreeningById(i);
+            int owned = 0;
+            for (int seat = 1; seat <= capacity; seat++) {
+                bool taken = owner[i][seat] != 0;
+                if (taken == s->isSeatAvailable(seat)) ok = false;
+                owned += taken;
+            }
+            if (owned != capacity - s->getFreeSeatCount()) ok = false;
+        }
+        for (int m = 1; m <= MOVIES; m++) {
+            Movie* movie = sys->findMovieById(m);
+            if (movie->getBookedSeats() != movieSeats[m] || movie->getRevenueCents() != movieSeats[m] * movie->getCostCents()) ok = false;
+        }
+        allOk = allOk && ok;
+
+        cout << setw(8) << threads << fixed << setprecision(0) << setw(14) << rate
+             << setprecision(2) << setw(10) << rate / baseRate << setw(12) << sold
+             << setw(12) << rejected.load() << "  " << (ok ? "ok" : "FAILED") << "\n";
+        delete sys;
+    }
+    cout << "(" << thread::hardware_concurrency() << " hardware threads available)\n";
+    return allOk;
+}
+
+int main(int argc, char* argv[]) {
+    // "--trace FILE" may come before the interactive or --batch mode.
+    const char* tracePath = nullptr;
+    if (argc > 2 && strcmp(argv[1], "--trace") == 0) {
+        tracePath = argv[2];
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        long long maxRecords = argc > 2 ? atoll(argv[2]) : 10000000;
+        runBenchmarks(maxRecords >= 100 ? maxRecords : 100);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--stress") == 0) {
+        int maxThreads = argc > 2 ? atoi(argv[2]) : 8;
+        return runStressTest(maxThreads > 0 ? maxThreads : 1) ? 0 : 1;
+    }
+    if (argc > 2 && strcmp(argv[1], "--replay") == 0) {
+        return runReplay(argv[2]) ? 0 : 1;
+    }
+    if (tracePath && !CinemaBookingSystem::getInstance()->startTrace(tracePath)) {
+        cerr << "Cannot write trace " << tracePath << "\n";
+        return 1;
+    }
+    if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+        FILE* in = argc > 2 ? fopen(argv[2], "rb") : stdin;
+        if (!in) {
+            cerr << "Cannot open " << argv[2] << "\n";
+            return 1;
+        }
+        runBatch(CinemaBookingSystem::getInstance(), in);
+        if (in != stdin) fclose(in);
+        delete CinemaBookingSystem::getInstance();
+        return 0;
+    }
+    CinemaBookingSystem::getInstance();
     string input;
     int choice;
     while (running) {